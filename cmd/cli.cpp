@@ -0,0 +1,479 @@
+#include "cmd/cli.h"
+
+#include <climits>
+#include <cstdlib>
+
+// Helper functions (moved outside class so they can be used globally)
+std::string expand_path(const std::string& path) {
+    if (path.empty() || path[0] != '~') {
+        return path;
+    }
+    
+    const char* home = std::getenv("HOME");
+    if (!home) {
+        return path;
+    }
+    
+    if (path.length() == 1 || path[1] == '/') {
+        return std::string(home) + path.substr(1);
+    }
+    
+    return path;
+}
+
+std::string validate_and_expand_path(const std::string& path, bool must_exist, bool force_directory) {
+    std::string expanded = expand_path(path);
+    
+    if (must_exist && !std::filesystem::exists(expanded)) {
+        return ""; // Invalid path
+    }
+    
+    if (force_directory && std::filesystem::exists(expanded) && std::filesystem::is_regular_file(expanded)) {
+        // Convert file path to directory path
+        expanded = std::filesystem::path(expanded).parent_path().string();
+        std::cout << "Note: Using parent directory: " << expanded << std::endl;
+    }
+    
+    return expanded;
+}
+
+std::string get_password_input() {
+    std::cout << "Enter password: ";
+    std::cout.flush();
+    
+    std::string password;
+    struct termios old_termios, new_termios;
+    
+    // Turn off echo
+    tcgetattr(STDIN_FILENO, &old_termios);
+    new_termios = old_termios;
+    new_termios.c_lflag &= ~ECHO;
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &new_termios);
+    
+    std::getline(std::cin, password);
+    
+    // Restore terminal
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &old_termios);
+    
+    std::cout << std::endl;
+    return password;
+}
+
+void InteractiveCLI::enable_raw_mode() {
+    tcgetattr(STDIN_FILENO, &old_termios);
+    struct termios raw = old_termios;
+    raw.c_lflag &= ~(ECHO | ICANON);
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &raw);
+}
+
+void InteractiveCLI::disable_raw_mode() {
+    tcsetattr(STDIN_FILENO, TCSAFLUSH, &old_termios);
+}
+
+std::vector<std::string> InteractiveCLI::get_completions(const std::string& partial_path) {
+    std::vector<std::string> completions;
+    std::string dir_path, filename_prefix;
+    split_completion_path(partial_path, dir_path, filename_prefix);
+    
+    // Matches come from the cached listing, already sorted
+    for (const std::string& name : completion_index.lookup(dir_path, filename_prefix)) {
+        std::string full_path;
+        if (dir_path == ".") {
+            full_path = name;
+        } else if (dir_path.back() == '/') {
+            full_path = dir_path + name;
+        } else {
+            full_path = dir_path + "/" + name;
+        }
+        
+        // Convert back to tilde format if original used ~ (C++17 compatible)
+        if (!partial_path.empty() && partial_path[0] == '~') {
+            const char* home_env = std::getenv("HOME");
+            std::string home = home_env ? home_env : "";
+            if (!home.empty() && full_path.length() >= home.length() && 
+                full_path.substr(0, home.length()) == home) {
+                full_path = "~" + full_path.substr(home.length());
+            }
+        }
+        
+        completions.push_back(full_path);
+    }
+    
+    return completions;
+}
+
+void InteractiveCLI::prefetch_completions(const std::string& partial_path) {
+    std::string dir_path, filename_prefix;
+    split_completion_path(partial_path, dir_path, filename_prefix);
+    completion_index.prefetch(dir_path);
+}
+
+std::string InteractiveCLI::read_line_with_completion(const std::string& prompt) {
+    std::cout << prompt;
+    std::cout.flush();
+    
+    std::string input;
+    int ch;
+    
+    enable_raw_mode();
+    prefetch_completions(input);
+    
+    while (true) {
+        ch = getchar();
+        
+        if (ch == '\n' || ch == '\r') {  // Enter
+            std::cout << std::endl;
+            break;
+        } else if (ch == '\t') {  // Tab for autocompletion
+            auto completions = get_completions(input);
+            
+            if (completions.size() == 1) {
+                // Single completion - auto-complete
+                std::cout << "\r" << std::string(prompt.length() + input.length(), ' ');
+                input = completions[0];
+                std::cout << "\r" << prompt << input;
+                if (input.back() == '/') prefetch_completions(input);
+            } else if (completions.size() > 1) {
+                // Multiple completions - show options
+                std::cout << std::endl;
+                std::cout << "Options:" << std::endl;
+                for (const auto& comp : completions) {
+                    std::cout << "  " << comp << std::endl;
+                }
+                std::cout << prompt << input;
+            }
+            std::cout.flush();
+        } else if (ch == 127 || ch == '\b') {  // Backspace
+            if (!input.empty()) {
+                input.pop_back();
+                std::cout << "\b \b";
+                std::cout.flush();
+            }
+        } else if (ch == 27) {  // Escape sequence (arrow keys, etc.)
+            getchar(); // Skip '['
+            getchar(); // Skip the actual key
+        } else if (ch >= 32 && ch <= 126) {  // Printable characters
+            input += ch;
+            std::cout << (char)ch;
+            std::cout.flush();
+            // List a directory while the rest of the name is typed
+            if (ch == '/') prefetch_completions(input);
+        }
+    }
+    
+    disable_raw_mode();
+    return input;
+}
+
+std::string InteractiveCLI::get_password() {
+    return get_password_input(); // Use the global function
+}
+
+int InteractiveCLI::run_interactive_cli(std::string& input, std::string& output, std::string& password, std::string& mode) {
+    std::cout << "=== File Encryption Tool ===" << std::endl;
+    std::cout << "Tab for autocompletion, Enter to confirm" << std::endl << std::endl;
+    
+    // Get operation mode
+    std::cout << "Choose operation:" << std::endl;
+    std::cout << "1. Encrypt (e)" << std::endl;
+    std::cout << "2. Decrypt (d)" << std::endl;
+    std::cout << "Enter choice (e/d): ";
+    
+    char choice;
+    std::cin >> choice;
+    std::cin.ignore(); // Clear the newline
+    
+    if (choice == 'e' || choice == 'E') {
+        mode = "enc";
+    } else if (choice == 'd' || choice == 'D') {
+        mode = "dec";
+    } else {
+        std::cerr << "Invalid choice. Please enter 'e' for encrypt or 'd' for decrypt." << std::endl;
+        return -1;
+    }
+    
+    // Get input file/folder
+    input = read_line_with_completion("Input file/folder: ");
+    if (input.empty()) {
+        std::cerr << "Input file/folder is required." << std::endl;
+        return -1;
+    }
+    
+    // Validate and expand input path
+    std::string validated_input = validate_and_expand_path(input, true, false);
+    if (validated_input.empty()) {
+        std::cerr << "Error: Input file/folder does not exist: " << input << std::endl;
+        return -1;
+    }
+    input = validated_input;
+    
+    // Get output path
+    output = read_line_with_completion("Output directory: ");
+    if (output.empty()) {
+        std::cerr << "Output directory is required." << std::endl;
+        return -1;
+    }
+    
+    // Validate and expand output path (force directory)
+    output = validate_and_expand_path(output, false, true);
+    
+    // Get password
+    password = get_password();
+    if (password.empty()) {
+        std::cerr << "Password is required." << std::endl;
+        return -1;
+    }
+    
+    // Confirm password for encryption
+    if (mode == "enc") {
+        std::cout << "Confirm password: ";
+        std::string confirm_password = get_password();
+        if (password != confirm_password) {
+            std::cerr << "Passwords do not match!" << std::endl;
+            return -1;
+        }
+    }
+    
+    std::cout << std::endl << "Operation: " << (mode == "enc" ? "Encrypt" : "Decrypt") << std::endl;
+    std::cout << "Input: " << input << std::endl;
+    std::cout << "Output: " << output << std::endl;
+    std::cout << "Proceeding..." << std::endl << std::endl;
+    
+    return 0;
+}
+
+// Parses a positive decimal number for a numeric option
+static bool parse_count(const char* text, uint32_t& value) {
+    char* end = nullptr;
+    unsigned long parsed = std::strtoul(text, &end, 10);
+    if (end == text || *end != '\0' || parsed == 0 || parsed > UINT32_MAX) {
+        return false;
+    }
+    value = static_cast<uint32_t>(parsed);
+    return true;
+}
+
+// Parses a byte size with an optional binary K, M, G or T suffix, e.g. 4G
+static bool parse_size(const char* text, uint64_t& value) {
+    char* end = nullptr;
+    unsigned long long parsed = std::strtoull(text, &end, 10);
+    if (end == text || parsed == 0) {
+        return false;
+    }
+    int shift = 0;
+    switch (*end) {
+        case '\0': break;
+        case 'K': case 'k': shift = 10; break;
+        case 'M': case 'm': shift = 20; break;
+        case 'G': case 'g': shift = 30; break;
+        case 'T': case 't': shift = 40; break;
+        default: return false;
+    }
+    if (*end != '\0' && end[1] != '\0') {
+        return false;
+    }
+    if (parsed > (UINT64_MAX >> shift)) {
+        return false;
+    }
+    value = static_cast<uint64_t>(parsed) << shift;
+    return true;
+}
+
+// Main CLI function that can handle both interactive and command-line modes
+int cli(int argc, char* argv[], std::string& input, std::string& output, std::string& password, std::string& mode,
+        CliOptions& options) {
+    // If no arguments or just the program name, run interactive mode
+    if (argc == 1) {
+        InteractiveCLI interactive;
+        return interactive.run_interactive_cli(input, output, password, mode);
+    }
+    
+    // Handle help flag
+    if (argc == 2 && std::string(argv[1]) == "-h") {
+        std::cout << "File Encryption Tool\n\n"
+                  << "Usage:\n"
+                  << "  " << argv[0] << "                          # Interactive mode\n"
+                  << "  " << argv[0] << " -i <input> -o <output> -p <password> (-e | -d)  # Command line mode\n"
+                  << "  " << argv[0] << " -p <password> (-e | -d) < in > out          # Pipe mode\n"
+                  << "  " << argv[0] << " -i <file.enc> -p <password> --verify        # Integrity check\n"
+                  << "  " << argv[0] << " -i <file.enc> -p <password> --rekey <new>   # Change password\n"
+                  << "  " << argv[0] << " -i <input> -o <archive.enc> -p <password> -e --append  # Add to a container\n\n"
+                  << "Interactive mode:\n"
+                  << "  Run without arguments for guided setup with tab autocompletion\n\n"
+                  << "Command line options:\n"
+                  << "  -i <input>     Input file or folder, or - for stdin\n"
+                  << "  -o <output>    Output directory, or - for stdout\n"
+                  << "  -p <password>  Password for encryption/decryption\n"
+                  << "  -e             Encrypt mode\n"
+                  << "  -d             Decrypt mode\n"
+                  << "  --verify       Check that an encrypted file is intact without writing anything\n"
+                  << "  --rekey <new>  Replace the password -p with <new>, rewriting only the key slots\n"
+                  << "  --add-key <new>  Let <new> open the file too, next to the existing passwords\n"
+                  << "  --remove-key   Remove the password -p from the file (the last one is kept)\n"
+                  << "  --compact      Drop replaced entries from a container (-i) to reclaim space\n"
+                  << "  -h             Show this help\n\n"
+                  << "Advanced options:\n"
+                  << "  --cipher <name>    aes-256-gcm, chacha20-poly1305, auto (pick from CPU features)\n"
+                  << "                   or bench (quick self-benchmark). Overrides ENCRYPTOR_CIPHER\n"
+                  << "  --kdf <name>       pbkdf2 (default) or argon2id (OpenSSL 3.2+)\n"
+                  << "  --kdf-target-ms <n>  Calibrate the KDF cost so unlocking takes about n ms here\n"
+                  << "  --kdf-memory <MiB>   Argon2id memory (default 64)\n"
+                  << "  --kdf-lanes <n>      Argon2id parallelism lanes (default 4)\n"
+                  << "  --fsync <policy>   none, file (fsync every output) or batch (sync once per\n"
+                  << "                   64 files and at exit, default)\n"
+                  << "  --threads <n>      Worker threads for --verify and --mirror (default: one per CPU)\n"
+                  << "  --resume           Journal progress so an interrupted -e/-d run continues\n"
+                  << "                   where it stopped when rerun with the same arguments\n"
+                  << "  --volume-size <n>  Split encrypted output into volumes of at most n bytes\n"
+                  << "                   (K, M, G, T suffixes allowed)\n"
+                  << "  --targets <dirs>   Comma-separated directories to spread volumes over, or to\n"
+                  << "                   look for them when decrypting or rekeying (default: next to -o / -i)\n"
+                  << "  --mirror           With a folder as -i: encrypt each file to its own .enc in a\n"
+                  << "                   mirrored tree under -o (or decrypt such a tree), in parallel,\n"
+                  << "                   skipping outputs that are already up to date\n"
+                  << "  --append           With -e: add -i to the appendable container at -o (created if\n"
+                  << "                   missing); only new or changed files are encrypted. -d on a\n"
+                  << "                   container extracts its latest files\n\n"
+                  << "Examples:\n"
+                  << "  " << argv[0] << " -i document.txt -o ~/encrypted_output -p mypassword -e\n"
+                  << "  " << argv[0] << " -i ~/encrypted_doc.txt.enc -o ~/decrypted_output -p mypassword -d\n"
+                  << "  tar c dir | " << argv[0] << " -p mypassword -e | ssh host 'cat > dir.tar.enc'\n";
+        return -1;
+    }
+    
+    // Command line mode - existing logic but improved
+    bool has_input = false, has_output = false, has_password = false, has_mode = false;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        
+        if (arg == "-i" && i + 1 < argc) {
+            input = argv[++i];
+            has_input = true;
+        } else if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+            has_output = true;
+        } else if (arg == "-p" && i + 1 < argc) {
+            password = argv[++i];
+            has_password = true;
+        } else if (arg == "-e") {
+            mode = "enc";
+            has_mode = true;
+        } else if (arg == "-d") {
+            mode = "dec";
+            has_mode = true;
+        } else if (arg == "--verify") {
+            mode = "verify";
+            has_mode = true;
+        } else if ((arg == "--rekey" || arg == "--add-key") && i + 1 < argc) {
+            mode = "rekey";
+            has_mode = true;
+            options.key_change = arg == "--rekey" ? "replace" : "add";
+            options.new_password = argv[++i];
+        } else if (arg == "--remove-key") {
+            mode = "rekey";
+            has_mode = true;
+            options.key_change = "remove";
+        } else if (arg == "--volume-size" && i + 1 < argc) {
+            if (!parse_size(argv[++i], options.volume_size)) {
+                std::cerr << "Error: --volume-size expects a size such as 4G." << std::endl;
+                return -1;
+            }
+        } else if (arg == "--targets" && i + 1 < argc) {
+            std::string list = argv[++i];
+            for (std::size_t start = 0; start <= list.size();) {
+                std::size_t comma = std::min(list.find(',', start), list.size());
+                if (comma > start) {
+                    options.targets.push_back(validate_and_expand_path(list.substr(start, comma - start), false, true));
+                }
+                start = comma + 1;
+            }
+        } else if (arg == "--compact") {
+            mode = "compact";
+            has_mode = true;
+        } else if (arg == "--append") {
+            options.append = true;
+        } else if (arg == "--mirror") {
+            options.mirror = true;
+        } else if (arg == "--resume") {
+            options.resume = true;
+        } else if (arg == "--cipher" && i + 1 < argc) {
+            options.cipher = argv[++i];
+        } else if (arg == "--fsync" && i + 1 < argc) {
+            options.fsync = argv[++i];
+        } else if (arg == "--kdf" && i + 1 < argc) {
+            options.kdf = argv[++i];
+        } else if ((arg == "--kdf-target-ms" || arg == "--kdf-memory" || arg == "--kdf-lanes" ||
+                    arg == "--threads") && i + 1 < argc) {
+            uint32_t& value = arg == "--kdf-target-ms" ? options.kdf_target_ms
+                            : arg == "--kdf-memory"    ? options.kdf_memory_mib
+                            : arg == "--kdf-lanes"     ? options.kdf_lanes
+                                                       : options.threads;
+            if (!parse_count(argv[++i], value)) {
+                std::cerr << "Error: " << arg << " expects a positive number." << std::endl;
+                return -1;
+            }
+        }
+    }
+    
+    if (!has_password || !has_mode) {
+        std::cerr << "Error: Missing required parameters.\n"
+                  << "Use '" << argv[0] << " -h' for help." << std::endl;
+        return -1;
+    }
+    
+    // Verify, rekey and compact modes work on a single encrypted file in place
+    if (mode == "verify" || mode == "rekey" || mode == "compact") {
+        if (!has_input) {
+            std::cerr << "Error: --" << mode << " needs an encrypted file (-i)." << std::endl;
+            return -1;
+        }
+        if (mode == "rekey" && options.key_change != "remove" && options.new_password.empty()) {
+            std::cerr << "Error: The new password must not be empty." << std::endl;
+            return -1;
+        }
+        input = expand_path(input);
+        if (!std::filesystem::is_regular_file(input)) {
+            std::cerr << "Error: Encrypted file does not exist: " << input << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+
+    // Pipe mode: without -i/-o data flows from stdin to stdout
+    if (!has_input) input = "-";
+    if (!has_output) output = "-";
+    if (input == "-" || output == "-") {
+        if (input != output) {
+            std::cerr << "Error: Pipe mode needs both stdin and stdout (-i - -o -)." << std::endl;
+            return -1;
+        }
+        if (options.resume || options.volume_size || options.mirror || options.append) {
+            std::cerr << "Error: --resume, --volume-size, --mirror and --append need an input and an output." << std::endl;
+            return -1;
+        }
+        if (isatty(STDIN_FILENO)) {
+            std::cerr << "Error: Pipe mode reads from stdin, but stdin is a terminal.\n"
+                      << "Use '" << argv[0] << " -h' for help." << std::endl;
+            return -1;
+        }
+        if (mode == "enc" && isatty(STDOUT_FILENO)) {
+            std::cerr << "Error: Refusing to write encrypted data to a terminal." << std::endl;
+            return -1;
+        }
+        return 0;
+    }
+    
+    // Expand and validate input exists
+    std::string expanded_input = expand_path(input);
+    if (!std::filesystem::exists(expanded_input)) {
+        std::cerr << "Error: Input file/folder does not exist: " << input << std::endl;
+        return -1;
+    }
+    input = expanded_input;
+    
+    // Expand and validate output path (force directory, except for a container)
+    output = options.append ? expand_path(output) : validate_and_expand_path(output, false, true);
+    
+    return 0;
+}
@@ -0,0 +1,92 @@
+#include "cmd/completion.h"
+#include "cmd/cli.h"
+
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+namespace {
+
+std::vector<std::string> scan_directory(const std::string& dir) {
+    std::vector<std::string> names;
+    std::error_code ec;
+    std::filesystem::directory_iterator it(dir, ec);
+    for (; !ec && it != std::filesystem::directory_iterator(); it.increment(ec)) {
+        std::string name = it->path().filename().string();
+        std::error_code type_error;
+        if (it->is_directory(type_error)) {
+            name += '/';
+        }
+        names.push_back(std::move(name));
+    }
+    std::sort(names.begin(), names.end());
+    return names;
+}
+
+bool is_ready(const std::shared_future<std::shared_ptr<const std::vector<std::string>>>& listing) {
+    return listing.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+} // namespace
+
+std::shared_future<CompletionIndex::Listing> CompletionIndex::listing_for(const std::string& dir) {
+    std::error_code ec;
+    std::filesystem::file_time_type mtime = std::filesystem::last_write_time(dir, ec);
+    if (ec) {
+        return {};
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto found = listings_.find(dir);
+    // A scan still running is kept even if the directory changed meanwhile;
+    // the next request after it finishes starts a fresh one
+    if (found != listings_.end() && (found->second.mtime == mtime || !is_ready(found->second.listing))) {
+        return found->second.listing;
+    }
+
+    // Scans run on detached threads, so leaving the prompt never waits for a
+    // slow directory nobody asked to complete in
+    std::promise<Listing> promise;
+    Entry entry;
+    entry.mtime = mtime;
+    entry.listing = promise.get_future().share();
+    std::thread([dir, promise = std::move(promise)]() mutable {
+        promise.set_value(std::make_shared<const std::vector<std::string>>(scan_directory(dir)));
+    }).detach();
+    listings_[dir] = entry;
+    return entry.listing;
+}
+
+void CompletionIndex::prefetch(const std::string& dir) {
+    listing_for(dir);
+}
+
+std::vector<std::string> CompletionIndex::lookup(const std::string& dir, const std::string& prefix) {
+    std::shared_future<Listing> pending = listing_for(dir);
+    if (!pending.valid()) {
+        return {};
+    }
+    Listing names = pending.get();
+
+    std::vector<std::string> matches;
+    auto it = std::lower_bound(names->begin(), names->end(), prefix);
+    for (; it != names->end() && it->compare(0, prefix.size(), prefix) == 0; ++it) {
+        // Skip hidden files unless explicitly requested
+        if (prefix.empty() && (*it)[0] == '.') continue;
+        matches.push_back(*it);
+    }
+    return matches;
+}
+
+void split_completion_path(const std::string& partial_path, std::string& dir_path, std::string& filename_prefix) {
+    std::string expanded_path = expand_path(partial_path);
+    if (expanded_path.empty() || expanded_path.back() == '/') {
+        dir_path = expanded_path.empty() ? "." : expanded_path;
+        filename_prefix = "";
+    } else {
+        std::filesystem::path path(expanded_path);
+        dir_path = path.parent_path().string();
+        if (dir_path.empty()) dir_path = ".";
+        filename_prefix = path.filename().string();
+    }
+}
@@ -0,0 +1,48 @@
+#ifndef COMPLETION_H
+#define COMPLETION_H
+
+// Cached directory listings for Tab completion.
+//
+// The first request for a directory starts a background scan that produces
+// its entry names, sorted, with directories marked by a trailing '/'. Later
+// requests binary-search that listing for the typed prefix, so completion in
+// a directory of 100k entries costs one stat (to compare the directory's
+// mtime) instead of a full scan and sort. A changed mtime triggers a new scan.
+
+#include <filesystem>
+#include <future>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class CompletionIndex {
+public:
+    // Starts scanning `dir` in the background unless an up-to-date listing
+    // is cached or already being built.
+    void prefetch(const std::string& dir);
+
+    // Names in `dir` starting with `prefix`, in sorted order. Waits for a
+    // pending scan of `dir`. Hidden entries only match a non-empty prefix.
+    std::vector<std::string> lookup(const std::string& dir, const std::string& prefix);
+
+private:
+    using Listing = std::shared_ptr<const std::vector<std::string>>;
+
+    struct Entry {
+        std::filesystem::file_time_type mtime;  // Taken before the scan started
+        std::shared_future<Listing> listing;
+    };
+
+    std::shared_future<Listing> listing_for(const std::string& dir);
+
+    std::mutex mutex_;
+    std::map<std::string, Entry> listings_;
+};
+
+// Splits a partially typed path into the directory to list and the prefix of
+// the name being completed. "~" is expanded.
+void split_completion_path(const std::string& partial_path, std::string& dir_path, std::string& filename_prefix);
+
+#endif // COMPLETION_H
@@ -0,0 +1,166 @@
+#include "internal/bulk.h"
+
+#include "internal/encryption.h"
+#include "internal/format.h"
+#include "internal/output.h"
+#include "internal/workpool.h"
+#include "internal/zip.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+
+namespace {
+
+struct BulkJob {
+    fs::path source;
+    fs::path target;
+    uint64_t size = 0;
+};
+
+// Lists the files to process, largest first, and mirrors the directory tree
+// under `output_dir`. The output tree is never walked, even when it lies
+// inside the input tree.
+std::vector<BulkJob> collect_jobs(const std::string& input_dir, const std::string& output_dir, bool decrypting) {
+    std::vector<BulkJob> jobs;
+    std::error_code ec;
+    fs::path output_root = fs::weakly_canonical(output_dir, ec);
+    fs::create_directories(output_dir, ec);
+
+    fs::recursive_directory_iterator it(input_dir, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        std::cerr << "Error iterating directory: " << ec.message() << std::endl;
+        return jobs;
+    }
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        const fs::directory_entry& entry = *it;
+        fs::path relative = fs::relative(entry.path(), input_dir);
+
+        if (entry.is_directory()) {
+            if (fs::weakly_canonical(entry.path(), ec) == output_root) {
+                it.disable_recursion_pending();
+            } else {
+                fs::create_directories(fs::path(output_dir) / relative, ec);
+            }
+            continue;
+        }
+        if (!entry.is_regular_file()) continue;
+
+        BulkJob job;
+        job.source = entry.path();
+        job.size = entry.file_size(ec);
+        if (decrypting) {
+            if (relative.extension() != ".enc") continue;
+            job.target = fs::path(output_dir) / relative.replace_extension();
+        } else {
+            job.target = fs::path(output_dir) / (relative.string() + ".enc");
+        }
+        jobs.push_back(job);
+    }
+
+    std::stable_sort(jobs.begin(), jobs.end(), [](const BulkJob& a, const BulkJob& b) { return a.size > b.size; });
+    return jobs;
+}
+
+// An output counts as up to date if it is at least as new as its source
+bool up_to_date(const BulkJob& job) {
+    std::error_code ec;
+    fs::file_time_type target_time = fs::last_write_time(job.target, ec);
+    if (ec) return false;
+    fs::file_time_type source_time = fs::last_write_time(job.source, ec);
+    return !ec && target_time >= source_time;
+}
+
+bool encrypt_one(const BulkJob& job, const std::string& password, const EncryptOptions& options, KeyCache& keys) {
+    std::ifstream in(job.source, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Failed to open input file: " << job.source << std::endl;
+        return false;
+    }
+
+    AtomicFileWriter out;
+    if (!out.open(job.target.string(), encrypted_size(job.size, options.chunk_size)) ||
+        !encrypt_stream(in, out.stream(), password, options, &keys)) {
+        std::cerr << "Error: Failed to encrypt: " << job.source << std::endl;
+        return false;
+    }
+    return !out.commit(PublishMode::REPLACE).empty();
+}
+
+bool decrypt_one(const BulkJob& job, const std::string& password, KeyCache& keys) {
+    std::ifstream in(job.source, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Failed to read encrypted file: " << job.source << std::endl;
+        return false;
+    }
+
+    AtomicFileWriter out;
+    FileHeader header;
+    if (!out.open(job.target.string(), job.size) || !decrypt_stream(in, out.stream(), password, &header, &keys) ||
+        !out.stream().flush()) {
+        std::cerr << "Error: Failed to decrypt: " << job.source << std::endl;
+        return false;
+    }
+
+    if (header.flags & HEADER_FLAG_RAW_PAYLOAD) {
+        return !out.commit(PublishMode::REPLACE).empty();
+    }
+    return unzip_file(out.read_path(), job.target.parent_path().string(), true);
+}
+
+template <typename Process>
+BulkStats run_jobs(const std::vector<BulkJob>& jobs, unsigned threads, Process process) {
+    auto start = std::chrono::steady_clock::now();
+    std::atomic<uint64_t> files{0};
+    std::atomic<uint64_t> skipped{0};
+    std::atomic<uint64_t> failed{0};
+    std::atomic<uint64_t> bytes{0};
+
+    WorkStealingPool pool(threads);
+    for (const BulkJob& job : jobs) {
+        pool.submit([&, job]() {
+            if (up_to_date(job)) {
+                skipped++;
+            } else if (process(job)) {
+                files++;
+                bytes += job.size;
+            } else {
+                failed++;
+            }
+        });
+    }
+    pool.run();
+
+    BulkStats stats;
+    stats.files = files;
+    stats.skipped = skipped;
+    stats.failed = failed;
+    stats.bytes = bytes;
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return stats;
+}
+
+} // namespace
+
+BulkStats encrypt_tree(const std::string& input_dir, const std::string& output_dir, const std::string& password,
+                       EncryptOptions options, unsigned threads) {
+    options.raw_payload = true;
+    options.salt = generated_salt_and_IV(SALT_SIZE);
+    if (options.salt.empty()) {
+        std::cerr << "Error: Failed to generate salt" << std::endl;
+        BulkStats stats;
+        stats.failed = 1;
+        return stats;
+    }
+
+    KeyCache keys;
+    std::vector<BulkJob> jobs = collect_jobs(input_dir, output_dir, false);
+    return run_jobs(jobs, threads, [&](const BulkJob& job) { return encrypt_one(job, password, options, keys); });
+}
+
+BulkStats decrypt_tree(const std::string& input_dir, const std::string& output_dir, const std::string& password,
+                       unsigned threads) {
+    KeyCache keys;
+    std::vector<BulkJob> jobs = collect_jobs(input_dir, output_dir, true);
+    return run_jobs(jobs, threads, [&](const BulkJob& job) { return decrypt_one(job, password, keys); });
+}
@@ -0,0 +1,37 @@
+#ifndef BULK_H
+#define BULK_H
+
+// Tree-mirroring bulk mode.
+//
+// encrypt_tree walks a directory and encrypts every regular file to the same
+// relative path under the output directory, with ".enc" appended. Each file
+// is a raw payload (no ZIP step, no temporary archive). All files of a run
+// share one salt, so the KDF runs once; every file still gets its own random
+// base nonce and decrypts on its own. Files are processed on a
+// WorkStealingPool, largest first, and outputs at least as new as their
+// source are skipped.
+
+#include "internal/encryptor.h"
+
+#include <cstdint>
+#include <string>
+
+struct BulkStats {
+    uint64_t files = 0;    // Encrypted or decrypted in this run
+    uint64_t skipped = 0;  // Output already up to date
+    uint64_t failed = 0;
+    uint64_t bytes = 0;    // Input bytes of the processed files
+    double seconds = 0;
+};
+
+// `threads` = 0 uses one worker per CPU. `options.raw_payload` and
+// `options.salt` are set by the run.
+BulkStats encrypt_tree(const std::string& input_dir, const std::string& output_dir, const std::string& password,
+                       EncryptOptions options, unsigned threads = 0);
+
+// Decrypts every *.enc file under `input_dir` to the mirrored path without
+// the extension. ZIP payloads are extracted into that path's folder instead.
+BulkStats decrypt_tree(const std::string& input_dir, const std::string& output_dir, const std::string& password,
+                       unsigned threads = 0);
+
+#endif // BULK_H
@@ -0,0 +1,204 @@
+#include "internal/cipher.h"
+
+#include <chrono>
+#include <cstdlib>
+
+#if defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#endif
+
+namespace {
+
+CpuFeatures detect_cpu_features() {
+    CpuFeatures features;
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_cpu_init();
+    features.aes = __builtin_cpu_supports("aes");
+    features.pclmul = __builtin_cpu_supports("pclmul");
+#elif defined(__aarch64__) && defined(__linux__)
+    unsigned long hwcap = getauxval(AT_HWCAP);
+    features.aes = (hwcap & HWCAP_AES) != 0;
+    features.pclmul = (hwcap & HWCAP_PMULL) != 0;
+#endif
+    return features;
+}
+
+const EVP_CIPHER* chacha20_poly1305_or_null() {
+#ifndef OPENSSL_NO_CHACHA
+    return EVP_chacha20_poly1305();
+#else
+    return nullptr;
+#endif
+}
+
+} // namespace
+
+const CpuFeatures& cpu_features() {
+    static const CpuFeatures features = detect_cpu_features();
+    return features;
+}
+
+const std::vector<CipherSuiteInfo>& cipher_registry() {
+    static const std::vector<CipherSuiteInfo> registry = {
+        {CipherSuite::AES_256_GCM, "aes-256-gcm", EVP_aes_256_gcm, true},
+        {CipherSuite::CHACHA20_POLY1305, "chacha20-poly1305", chacha20_poly1305_or_null, true},
+        {CipherSuite::AES_256_CBC, "aes-256-cbc", EVP_aes_256_cbc, false},
+    };
+    return registry;
+}
+
+const CipherSuiteInfo* find_cipher_suite(CipherSuite id) {
+    for (const auto& suite : cipher_registry()) {
+        if (suite.id == id) return &suite;
+    }
+    return nullptr;
+}
+
+const CipherSuiteInfo* find_cipher_suite(const std::string& name) {
+    for (const auto& suite : cipher_registry()) {
+        if (name == suite.name) return &suite;
+    }
+    return nullptr;
+}
+
+bool cipher_suite_available(const CipherSuiteInfo& suite) {
+    return suite.aead && suite.cipher() != nullptr;
+}
+
+double benchmark_cipher_suite(const CipherSuiteInfo& suite, std::size_t bytes) {
+    if (!cipher_suite_available(suite)) return 0.0;
+
+    SecureBytes key = generated_key(KEY_SIZE);
+    std::vector<uint8_t> nonce = generated_salt_and_IV(AEAD_NONCE_SIZE);
+    if (key.empty() || nonce.empty()) return 0.0;
+
+    ChunkCipher cipher;
+    if (!cipher.init(suite, key, nonce, {}, true)) return 0.0;
+
+    const std::size_t chunk = 64 * 1024;
+    PooledBuffer in(chunk);
+    PooledBuffer out(chunk + AEAD_TAG_SIZE);
+    std::fill(in.data(), in.data() + chunk, 0x5a);
+
+    auto start = std::chrono::steady_clock::now();
+    uint64_t index = 0;
+    for (std::size_t done = 0; done < bytes; done += chunk) {
+        if (!cipher.seal(index++, false, in.data(), chunk, out.data())) return 0.0;
+    }
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    if (elapsed.count() <= 0.0) return 0.0;
+    return static_cast<double>(bytes) / (1024.0 * 1024.0) / elapsed.count();
+}
+
+CipherSuite select_cipher_suite(bool benchmark) {
+    if (benchmark) {
+        CipherSuite best = CipherSuite::AES_256_GCM;
+        double best_speed = 0.0;
+        for (const auto& suite : cipher_registry()) {
+            double speed = benchmark_cipher_suite(suite);
+            if (speed > best_speed) {
+                best_speed = speed;
+                best = suite.id;
+            }
+        }
+        return best;
+    }
+
+    // AES-GCM is only fast with both AES rounds and GHASH in hardware; OpenSSL
+    // switches to its VAES/VPCLMULQDQ kernels by itself when those exist.
+    const CpuFeatures& features = cpu_features();
+    const CipherSuiteInfo* chacha = find_cipher_suite(CipherSuite::CHACHA20_POLY1305);
+    if ((!features.aes || !features.pclmul) && chacha && cipher_suite_available(*chacha)) {
+        return CipherSuite::CHACHA20_POLY1305;
+    }
+    return CipherSuite::AES_256_GCM;
+}
+
+bool resolve_cipher_suite(const std::string& name, CipherSuite& suite) {
+    if (name == "auto") {
+        suite = select_cipher_suite(false);
+        return true;
+    }
+    if (name == "bench") {
+        suite = select_cipher_suite(true);
+        return true;
+    }
+    const CipherSuiteInfo* info = find_cipher_suite(name);
+    if (!info || !cipher_suite_available(*info)) {
+        return false;
+    }
+    suite = info->id;
+    return true;
+}
+
+CipherSuite default_cipher_suite() {
+    static const CipherSuite suite = [] {
+        CipherSuite chosen = CipherSuite::AES_256_GCM;
+        const char* env = std::getenv("ENCRYPTOR_CIPHER");
+        if (env && *env) {
+            if (resolve_cipher_suite(env, chosen)) return chosen;
+            std::cerr << "Warning: Ignoring unknown ENCRYPTOR_CIPHER: " << env << std::endl;
+        }
+        return select_cipher_suite(false);
+    }();
+    return suite;
+}
+
+bool ChunkCipher::init(const CipherSuiteInfo& suite, const SecureBytes& key,
+                       const std::vector<uint8_t>& base_nonce, const std::vector<uint8_t>& aad, bool encrypt) {
+    const EVP_CIPHER* cipher = suite.aead ? suite.cipher() : nullptr;
+    if (!ctx_.valid() || !cipher || key.size() != static_cast<std::size_t>(EVP_CIPHER_key_length(cipher)) ||
+        base_nonce.size() != AEAD_NONCE_SIZE) {
+        std::cerr << "Error: Cipher suite " << suite.name << " cannot be initialized." << std::endl;
+        return false;
+    }
+
+    encrypt_ = encrypt;
+    base_nonce_ = base_nonce;
+    aad_ = aad;
+
+    if (EVP_CipherInit_ex(ctx_.get(), cipher, nullptr, nullptr, nullptr, encrypt ? 1 : 0) != 1 ||
+        EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_SET_IVLEN, AEAD_NONCE_SIZE, nullptr) != 1 ||
+        EVP_CipherInit_ex(ctx_.get(), nullptr, nullptr, key.data(), nullptr, encrypt ? 1 : 0) != 1) {
+        std::cerr << "Error: Cipher initialization failed." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool ChunkCipher::start_chunk(uint64_t index, bool final) {
+    uint8_t nonce[AEAD_NONCE_SIZE];
+    std::copy(base_nonce_.begin(), base_nonce_.end(), nonce);
+    for (int i = 0; i < 8; ++i) {
+        nonce[AEAD_NONCE_SIZE - 1 - i] ^= static_cast<uint8_t>(index >> (8 * i));
+    }
+
+    int len = 0;
+    const uint8_t final_flag = final ? 1 : 0;
+    if (EVP_CipherInit_ex(ctx_.get(), nullptr, nullptr, nullptr, nonce, encrypt_ ? 1 : 0) != 1) return false;
+    if (!aad_.empty() && EVP_CipherUpdate(ctx_.get(), nullptr, &len, aad_.data(), static_cast<int>(aad_.size())) != 1) return false;
+    return EVP_CipherUpdate(ctx_.get(), nullptr, &len, &final_flag, 1) == 1;
+}
+
+bool ChunkCipher::seal(uint64_t index, bool final, const uint8_t* in, std::size_t len, uint8_t* out) {
+    int out_len = 0;
+    int final_len = 0;
+    if (!start_chunk(index, final)) return false;
+    if (len > 0 && EVP_CipherUpdate(ctx_.get(), out, &out_len, in, static_cast<int>(len)) != 1) return false;
+    if (EVP_CipherFinal_ex(ctx_.get(), out + out_len, &final_len) != 1) return false;
+    return EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_GET_TAG, AEAD_TAG_SIZE, out + len) == 1;
+}
+
+bool ChunkCipher::open(uint64_t index, bool final, const uint8_t* in, std::size_t len, uint8_t* out) {
+    if (len < static_cast<std::size_t>(AEAD_TAG_SIZE)) return false;
+    std::size_t body = len - AEAD_TAG_SIZE;
+
+    int out_len = 0;
+    int final_len = 0;
+    if (!start_chunk(index, final)) return false;
+    if (body > 0 && EVP_CipherUpdate(ctx_.get(), out, &out_len, in, static_cast<int>(body)) != 1) return false;
+    if (EVP_CIPHER_CTX_ctrl(ctx_.get(), EVP_CTRL_AEAD_SET_TAG, AEAD_TAG_SIZE,
+                            const_cast<uint8_t*>(in + body)) != 1) return false;
+    return EVP_CipherFinal_ex(ctx_.get(), out + out_len, &final_len) == 1;
+}
@@ -0,0 +1,89 @@
+#ifndef CIPHER_H
+#define CIPHER_H
+
+#include "internal/encryption.h"
+#include "internal/pool.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+constexpr int AEAD_NONCE_SIZE = 12;
+constexpr int AEAD_TAG_SIZE = 16;
+
+// Suite IDs are stored in the file header, so existing values must never change.
+enum class CipherSuite : uint8_t {
+    AES_256_CBC = 0,        // Legacy [salt][IV][CBC] files only, never selected for new output
+    AES_256_GCM = 1,        // AES-NI + PCLMULQDQ fast path (VAES kernels chosen by OpenSSL)
+    CHACHA20_POLY1305 = 2,  // Fallback for CPUs without AES instructions
+};
+
+// Only the baseline AES and carry-less multiply instructions decide the suite;
+// OpenSSL picks its own VAES/VPCLMULQDQ kernels for AES-GCM when present.
+struct CpuFeatures {
+    bool aes = false;         // AES-NI (x86) or ARMv8 AES
+    bool pclmul = false;      // Carry-less multiply used by GHASH (PCLMULQDQ / PMULL)
+};
+
+struct CipherSuiteInfo {
+    CipherSuite id;
+    const char* name;
+    const EVP_CIPHER* (*cipher)();
+    bool aead;
+};
+
+// CPU features are probed once per process.
+const CpuFeatures& cpu_features();
+
+// All suites known to this build, in preference order when hardware allows.
+const std::vector<CipherSuiteInfo>& cipher_registry();
+const CipherSuiteInfo* find_cipher_suite(CipherSuite id);
+const CipherSuiteInfo* find_cipher_suite(const std::string& name);
+
+// True when the suite is compiled into OpenSSL and usable for new output.
+bool cipher_suite_available(const CipherSuiteInfo& suite);
+
+// Encrypts `bytes` of data with the suite and returns the throughput in MB/s,
+// or 0 if the suite failed.
+double benchmark_cipher_suite(const CipherSuiteInfo& suite, std::size_t bytes = 4 * 1024 * 1024);
+
+// Picks the fastest usable suite: from CPU features, or by running
+// benchmark_cipher_suite on each candidate when `benchmark` is set.
+CipherSuite select_cipher_suite(bool benchmark);
+
+// Suite used when the caller does not choose one. Honours the ENCRYPTOR_CIPHER
+// environment variable (a suite name, "auto" or "bench"), otherwise falls
+// back to select_cipher_suite(false). Resolved once per process.
+CipherSuite default_cipher_suite();
+
+// Resolves a user supplied suite name, "auto" or "bench". Returns false for
+// unknown or unavailable suites.
+bool resolve_cipher_suite(const std::string& name, CipherSuite& suite);
+
+// Seals or opens the fixed-size chunks of the streaming format with an AEAD
+// suite. The key schedule is set up once; each chunk only loads a new nonce,
+// derived from the base nonce and the chunk index. The final chunk is bound
+// into the additional data so truncated streams fail to authenticate. The
+// context comes from the thread's pool and goes back when the object dies.
+class ChunkCipher {
+public:
+    bool init(const CipherSuiteInfo& suite, const SecureBytes& key,
+              const std::vector<uint8_t>& base_nonce, const std::vector<uint8_t>& aad, bool encrypt);
+
+    // Writes `len` bytes of ciphertext followed by the tag to `out`.
+    bool seal(uint64_t index, bool final, const uint8_t* in, std::size_t len, uint8_t* out);
+
+    // `len` includes the trailing tag; writes len - AEAD_TAG_SIZE bytes to `out`.
+    bool open(uint64_t index, bool final, const uint8_t* in, std::size_t len, uint8_t* out);
+
+private:
+    bool start_chunk(uint64_t index, bool final);
+
+    PooledCipherContext ctx_;
+    std::vector<uint8_t> base_nonce_;
+    std::vector<uint8_t> aad_;
+    bool encrypt_ = true;
+};
+
+#endif // CIPHER_H
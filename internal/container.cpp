@@ -0,0 +1,613 @@
+#include "internal/container.h"
+
+#include "internal/cipher.h"
+#include "internal/encryption.h"
+#include "internal/format.h"
+#include "internal/keyslot.h"
+#include "internal/output.h"
+#include "internal/pool.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <map>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace {
+
+constexpr uint64_t RECORDS_OFFSET = FILE_HEADER_SIZE + KEY_SLOTS_SIZE;
+
+struct CommitRecord {
+    uint64_t generation = 0;
+    uint64_t index_offset = 0;
+    uint64_t index_size = 0;  // Plaintext bytes
+    std::vector<uint8_t> nonce;
+};
+
+// State of an opened container. The descriptor is owned by the caller.
+struct Container {
+    FileHeader header;
+    std::vector<uint8_t> header_bytes;
+    SecureBytes key;
+    CommitRecord record;          // Current commit
+    std::size_t record_slot = 0;  // Which of the two records holds it
+    std::map<std::string, ContainerEntry> entries;
+    uint64_t end = 0;             // End of the current index; appends start here
+
+    Container() = default;
+    Container(const Container&) = delete;
+    Container& operator=(const Container&) = delete;
+    ~Container() { secure_clear(key); }
+};
+
+// A file about to be added.
+struct Source {
+    std::string name;
+    fs::path path;
+};
+
+uint64_t sealed_length(uint64_t size, uint32_t chunk_size) {
+    uint64_t chunks = size == 0 ? 1 : (size + chunk_size - 1) / chunk_size;
+    return size + chunks * AEAD_TAG_SIZE;
+}
+
+std::vector<uint8_t> index_aad(const std::vector<uint8_t>& header_bytes) {
+    std::vector<uint8_t> aad(header_bytes);
+    aad.insert(aad.end(), CONTAINER_INDEX_AAD, CONTAINER_INDEX_AAD + sizeof(CONTAINER_INDEX_AAD) - 1);
+    return aad;
+}
+
+std::vector<uint8_t> serialize_record(const CommitRecord& record) {
+    std::vector<uint8_t> out(CONTAINER_RECORD_SIZE, 0);
+    std::memcpy(out.data(), CONTAINER_RECORD_MAGIC, sizeof(CONTAINER_RECORD_MAGIC));
+    put_u64(out.data() + 8, record.generation);
+    put_u64(out.data() + 16, record.index_offset);
+    put_u64(out.data() + 24, record.index_size);
+    std::copy(record.nonce.begin(), record.nonce.end(), out.begin() + 32);
+    return out;
+}
+
+bool parse_record(const uint8_t* data, CommitRecord& record) {
+    if (std::memcmp(data, CONTAINER_RECORD_MAGIC, sizeof(CONTAINER_RECORD_MAGIC)) != 0) {
+        return false;
+    }
+    record.generation = get_u64(data + 8);
+    record.index_offset = get_u64(data + 16);
+    record.index_size = get_u64(data + 24);
+    record.nonce.assign(data + 32, data + 32 + AEAD_NONCE_SIZE);
+    return record.index_offset >= CONTAINER_DATA_OFFSET;
+}
+
+// Index layout: entry count (8), then per entry name length (4) | name |
+// mode (4) | mtime (8) | size (8) | segment offset (8) | nonce (12)
+std::vector<uint8_t> serialize_index(const std::map<std::string, ContainerEntry>& entries) {
+    std::vector<uint8_t> out(8);
+    put_u64(out.data(), entries.size());
+    for (const auto& item : entries) {
+        const ContainerEntry& entry = item.second;
+        std::size_t at = out.size();
+        out.resize(at + 4 + entry.name.size() + 28 + AEAD_NONCE_SIZE);
+        uint8_t* p = out.data() + at;
+        put_u32(p, static_cast<uint32_t>(entry.name.size()));
+        std::memcpy(p + 4, entry.name.data(), entry.name.size());
+        p += 4 + entry.name.size();
+        put_u32(p, entry.mode);
+        put_u64(p + 4, entry.mtime);
+        put_u64(p + 12, entry.size);
+        put_u64(p + 20, entry.offset);
+        std::copy(entry.nonce.begin(), entry.nonce.end(), p + 28);
+    }
+    return out;
+}
+
+bool parse_index(const std::vector<uint8_t>& bytes, std::map<std::string, ContainerEntry>& entries) {
+    if (bytes.size() < 8) return false;
+    uint64_t count = get_u64(bytes.data());
+    std::size_t at = 8;
+    entries.clear();
+    for (uint64_t i = 0; i < count; ++i) {
+        if (bytes.size() - at < 4) return false;
+        uint32_t name_size = get_u32(bytes.data() + at);
+        if (bytes.size() - at - 4 < static_cast<uint64_t>(name_size) + 28 + AEAD_NONCE_SIZE) return false;
+        const uint8_t* p = bytes.data() + at + 4;
+
+        ContainerEntry entry;
+        entry.name.assign(reinterpret_cast<const char*>(p), name_size);
+        p += name_size;
+        entry.mode = get_u32(p);
+        entry.mtime = get_u64(p + 4);
+        entry.size = get_u64(p + 12);
+        entry.offset = get_u64(p + 20);
+        entry.nonce.assign(p + 28, p + 28 + AEAD_NONCE_SIZE);
+        at += 4 + name_size + 28 + AEAD_NONCE_SIZE;
+        entries[entry.name] = entry;
+    }
+    return at == bytes.size();
+}
+
+// Seals `size` bytes, fetched through read(buffer, position, length), as a
+// segment at `offset` of `fd`.
+template <typename Read>
+bool seal_segment(const Container& c, const std::vector<uint8_t>& nonce, const std::vector<uint8_t>& aad,
+                  uint64_t size, Read read, int fd, uint64_t offset) {
+    ChunkCipher cipher;
+    if (!cipher.init(*find_cipher_suite(c.header.suite), c.key, nonce, aad, true)) {
+        return false;
+    }
+    const uint32_t chunk_size = c.header.chunk_size;
+    const uint64_t chunks = size == 0 ? 1 : (size + chunk_size - 1) / chunk_size;
+    PooledBuffer plain(chunk_size);
+    PooledBuffer sealed(chunk_size + AEAD_TAG_SIZE);
+    for (uint64_t index = 0; index < chunks; ++index) {
+        std::size_t length = static_cast<std::size_t>(std::min<uint64_t>(chunk_size, size - index * chunk_size));
+        if (!read(plain.data(), index * chunk_size, length) ||
+            !cipher.seal(index, index + 1 == chunks, plain.data(), length, sealed.data()) ||
+            !pwrite_full(fd, sealed.data(), length + AEAD_TAG_SIZE, offset)) {
+            return false;
+        }
+        offset += length + AEAD_TAG_SIZE;
+    }
+    return true;
+}
+
+// Opens the segment at `offset` and hands each chunk's plaintext to
+// write(data, position, length).
+template <typename Write>
+bool open_segment(const Container& c, const std::vector<uint8_t>& nonce, const std::vector<uint8_t>& aad,
+                  uint64_t size, int fd, uint64_t offset, Write write) {
+    ChunkCipher cipher;
+    if (!cipher.init(*find_cipher_suite(c.header.suite), c.key, nonce, aad, false)) {
+        return false;
+    }
+    const uint32_t chunk_size = c.header.chunk_size;
+    const uint64_t chunks = size == 0 ? 1 : (size + chunk_size - 1) / chunk_size;
+    PooledBuffer sealed(chunk_size + AEAD_TAG_SIZE);
+    PooledBuffer plain(chunk_size);
+    for (uint64_t index = 0; index < chunks; ++index) {
+        std::size_t length = static_cast<std::size_t>(std::min<uint64_t>(chunk_size, size - index * chunk_size));
+        if (!pread_full(fd, sealed.data(), length + AEAD_TAG_SIZE, offset) ||
+            !cipher.open(index, index + 1 == chunks, sealed.data(), length + AEAD_TAG_SIZE, plain.data()) ||
+            !write(plain.data(), index * chunk_size, length)) {
+            return false;
+        }
+        offset += length + AEAD_TAG_SIZE;
+    }
+    return true;
+}
+
+bool load_index(int fd, Container& c, const CommitRecord& record) {
+    std::vector<uint8_t> bytes(record.index_size);
+    auto collect = [&](const uint8_t* data, uint64_t position, std::size_t length) {
+        std::memcpy(bytes.data() + position, data, length);
+        return true;
+    };
+    return open_segment(c, record.nonce, index_aad(c.header_bytes), record.index_size, fd, record.index_offset,
+                        collect) &&
+           parse_index(bytes, c.entries);
+}
+
+// Reads the header, unlocks the data key and loads the newest index that opens.
+bool load_container(int fd, const std::string& path, const std::string& password, Container& c) {
+    std::vector<uint8_t> prefix(CONTAINER_DATA_OFFSET);
+    if (!pread_full(fd, prefix.data(), prefix.size(), 0)) {
+        std::cerr << "Error: Not a container: " << path << std::endl;
+        return false;
+    }
+    c.header_bytes.assign(prefix.begin(), prefix.begin() + FILE_HEADER_SIZE);
+    if (!parse_header(c.header_bytes, c.header)) {
+        return false;
+    }
+    if (!(c.header.flags & HEADER_FLAG_CONTAINER) || !(c.header.flags & HEADER_FLAG_KEY_SLOTS) ||
+        !parse_key_slots(prefix.data() + FILE_HEADER_SIZE, KEY_SLOTS_SIZE, c.header)) {
+        std::cerr << "Error: Not a container: " << path << std::endl;
+        return false;
+    }
+    c.key = unlock_file_key(c.header, password);
+    if (c.key.empty()) {
+        return false;
+    }
+
+    // A record is only considered if its index lies within the file
+    struct stat st;
+    uint64_t file_size = ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+    CommitRecord records[2];
+    bool valid[2];
+    for (std::size_t slot = 0; slot < 2; ++slot) {
+        valid[slot] = parse_record(prefix.data() + RECORDS_OFFSET + slot * CONTAINER_RECORD_SIZE, records[slot]) &&
+                      records[slot].index_size < file_size && records[slot].index_offset < file_size &&
+                      sealed_length(records[slot].index_size, c.header.chunk_size) <=
+                          file_size - records[slot].index_offset;
+    }
+    std::size_t order[2] = {0, 1};
+    if (valid[1] && (!valid[0] || records[1].generation > records[0].generation)) {
+        std::swap(order[0], order[1]);
+    }
+    for (std::size_t slot : order) {
+        if (valid[slot] && load_index(fd, c, records[slot])) {
+            c.record = records[slot];
+            c.record_slot = slot;
+            c.end = records[slot].index_offset + sealed_length(records[slot].index_size, c.header.chunk_size);
+            return true;
+        }
+    }
+    std::cerr << "Error: No readable index in container: " << path << std::endl;
+    return false;
+}
+
+// Seals the index of `c` at `offset`, syncs, then points the older commit
+// record at it and syncs again.
+bool commit_index(int fd, Container& c, uint64_t offset) {
+    std::vector<uint8_t> bytes = serialize_index(c.entries);
+    CommitRecord record;
+    record.generation = c.record.generation + 1;
+    record.index_offset = offset;
+    record.index_size = bytes.size();
+    record.nonce = generated_salt_and_IV(AEAD_NONCE_SIZE);
+    if (record.nonce.empty()) {
+        return false;
+    }
+
+    auto fetch = [&](uint8_t* data, uint64_t position, std::size_t length) {
+        std::memcpy(data, bytes.data() + position, length);
+        return true;
+    };
+    std::size_t slot = 1 - c.record_slot;
+    std::vector<uint8_t> record_bytes = serialize_record(record);
+    if (!seal_segment(c, record.nonce, index_aad(c.header_bytes), bytes.size(), fetch, fd, offset) ||
+        ::fdatasync(fd) != 0 ||
+        !pwrite_full(fd, record_bytes.data(), record_bytes.size(), RECORDS_OFFSET + slot * CONTAINER_RECORD_SIZE) ||
+        ::fdatasync(fd) != 0) {
+        std::cerr << "Error: Failed to commit container index (" << std::strerror(errno) << ")" << std::endl;
+        return false;
+    }
+    c.record = record;
+    c.record_slot = slot;
+    c.end = offset + sealed_length(record.index_size, c.header.chunk_size);
+    return true;
+}
+
+// Creates an empty container with its first commit.
+bool create_container(const std::string& path, const std::string& password, const EncryptOptions& options) {
+    Container c;
+    if (!new_file_header(options, c.header)) {
+        return false;
+    }
+    c.header.flags = HEADER_FLAG_KEY_SLOTS | HEADER_FLAG_CONTAINER;
+    c.key = new_data_key(c.header, password);
+    if (c.key.empty()) {
+        return false;
+    }
+    c.header_bytes = serialize_header(c.header);
+    std::vector<uint8_t> prefix(c.header_bytes);
+    std::vector<uint8_t> key_slots = serialize_key_slots(c.header);
+    prefix.insert(prefix.end(), key_slots.begin(), key_slots.end());
+    prefix.resize(CONTAINER_DATA_OFFSET, 0);
+
+    AtomicFileWriter out;
+    if (!out.open(path, CONTAINER_DATA_OFFSET + 8 + AEAD_TAG_SIZE) ||
+        !pwrite_full(out.fd(), prefix.data(), prefix.size(), 0) || !commit_index(out.fd(), c, CONTAINER_DATA_OFFSET) ||
+        !out.resize(c.end)) {
+        return false;
+    }
+    std::string created = out.commit();
+    if (created != path) {
+        std::cerr << "Error: Container appeared while being created: " << path << std::endl;
+        if (!created.empty()) ::unlink(created.c_str());
+        return false;
+    }
+    return true;
+}
+
+// Appends and compaction must not overlap.
+// Opens `path` for writing and takes the exclusive lock. Compaction replaces
+// the file by rename, so the lock may land on an inode that was unlinked
+// after open(); the path is then reopened until lock and name agree.
+FileDescriptor lock_container(const std::string& path) {
+    for (int attempt = 0; attempt < 8; ++attempt) {
+        FileDescriptor fd(::open(path.c_str(), O_RDWR | O_CLOEXEC));
+        if (fd.get() < 0) {
+            std::cerr << "Error: Failed to open container: " << path << std::endl;
+            return FileDescriptor(-1);
+        }
+        if (::flock(fd.get(), LOCK_EX | LOCK_NB) != 0) {
+            std::cerr << "Error: Container is in use by another process: " << path << std::endl;
+            return FileDescriptor(-1);
+        }
+        struct stat locked, named;
+        if (::fstat(fd.get(), &locked) != 0) {
+            std::cerr << "Error: Failed to open container: " << path << std::endl;
+            return FileDescriptor(-1);
+        }
+        if (::stat(path.c_str(), &named) == 0 && locked.st_dev == named.st_dev && locked.st_ino == named.st_ino) {
+            return fd;
+        }
+    }
+    std::cerr << "Error: Container keeps being replaced while opening it: " << path << std::endl;
+    return FileDescriptor(-1);
+}
+
+// Every regular file of `input` with its entry name. The container itself is
+// skipped when it lies inside the input tree.
+std::vector<Source> collect_sources(const std::string& input, const std::string& container) {
+    std::vector<Source> sources;
+    std::error_code ec;
+    fs::path root = fs::absolute(input, ec).lexically_normal();
+    if (root.filename().empty()) root = root.parent_path();
+    fs::path base = root.parent_path();
+    fs::path self = fs::weakly_canonical(container, ec);
+
+    auto add = [&](const fs::path& path) {
+        if (fs::weakly_canonical(path, ec) == self) return;
+        sources.push_back({path.lexically_relative(base).generic_string(), path});
+    };
+    if (fs::is_regular_file(root, ec)) {
+        add(root);
+        return sources;
+    }
+
+    fs::recursive_directory_iterator it(root, fs::directory_options::skip_permission_denied, ec);
+    if (ec) {
+        std::cerr << "Error iterating directory: " << ec.message() << std::endl;
+        return sources;
+    }
+    for (; it != fs::recursive_directory_iterator(); it.increment(ec)) {
+        if (it->is_regular_file(ec)) add(it->path());
+    }
+    std::sort(sources.begin(), sources.end(), [](const Source& a, const Source& b) { return a.name < b.name; });
+    return sources;
+}
+
+// Rejects names that would leave the output folder.
+bool safe_entry_name(const std::string& name) {
+    fs::path path(name);
+    if (name.empty() || path.is_absolute()) return false;
+    for (const fs::path& part : path) {
+        if (part == "..") return false;
+    }
+    return true;
+}
+
+void fill_stats(const Container& c, int fd, ContainerStats& stats) {
+    stats.entries = c.entries.size();
+    stats.live_bytes = 0;
+    for (const auto& item : c.entries) {
+        stats.live_bytes += sealed_length(item.second.size, c.header.chunk_size);
+    }
+    struct stat st;
+    stats.file_size = ::fstat(fd, &st) == 0 ? static_cast<uint64_t>(st.st_size) : 0;
+}
+
+// Copies `size` bytes between descriptors, in the kernel where possible.
+bool copy_range(int in, uint64_t in_offset, int out, uint64_t out_offset, uint64_t size) {
+    while (size > 0) {
+        loff_t from = static_cast<loff_t>(in_offset);
+        loff_t to = static_cast<loff_t>(out_offset);
+        ssize_t copied = ::copy_file_range(in, &from, out, &to, static_cast<std::size_t>(size), 0);
+        if (copied < 0 && errno == EINTR) continue;
+        if (copied <= 0) break;
+        in_offset += copied;
+        out_offset += copied;
+        size -= copied;
+    }
+
+    PooledBuffer buffer(STREAM_BUFFER_SIZE);
+    while (size > 0) {
+        std::size_t length = static_cast<std::size_t>(std::min<uint64_t>(size, buffer.size()));
+        if (!pread_full(in, buffer.data(), length, in_offset) || !pwrite_full(out, buffer.data(), length, out_offset)) {
+            return false;
+        }
+        in_offset += length;
+        out_offset += length;
+        size -= length;
+    }
+    return true;
+}
+
+} // namespace
+
+bool is_container_file(const std::string& path) {
+    FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    uint8_t bytes[FILE_HEADER_SIZE];
+    return fd.get() >= 0 && pread_full(fd.get(), bytes, sizeof(bytes), 0) && has_file_magic(bytes, sizeof(bytes)) &&
+           (bytes[7] & HEADER_FLAG_CONTAINER);
+}
+
+bool append_to_container(const std::string& input, const std::string& container, const std::string& password,
+                         const EncryptOptions& options, ContainerStats& stats) {
+    stats = ContainerStats();
+    if (!fs::exists(container)) {
+        if (!create_container(container, password, options)) {
+            return false;
+        }
+        std::cout << "Created container: " << container << std::endl;
+    }
+
+    FileDescriptor fd = lock_container(container);
+    Container c;
+    if (fd.get() < 0 || !load_container(fd.get(), container, password, c)) {
+        return false;
+    }
+
+    // Anything past the current index is left over from an interrupted append
+    if (::ftruncate(fd.get(), static_cast<off_t>(c.end)) != 0) {
+        std::cerr << "Error: Failed to truncate container: " << container << std::endl;
+        return false;
+    }
+
+    uint64_t offset = c.end;
+    for (const Source& source : collect_sources(input, container)) {
+        FileDescriptor in(::open(source.path.c_str(), O_RDONLY | O_CLOEXEC));
+        struct stat st;
+        if (in.get() < 0 || ::fstat(in.get(), &st) != 0) {
+            std::cerr << "Error: Failed to open input file: " << source.path << std::endl;
+            ::ftruncate(fd.get(), static_cast<off_t>(c.end));
+            return false;
+        }
+
+        ContainerEntry entry;
+        entry.name = source.name;
+        entry.mode = static_cast<uint32_t>(st.st_mode & 07777);
+        entry.mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+        entry.size = static_cast<uint64_t>(st.st_size);
+        auto existing = c.entries.find(entry.name);
+        if (existing != c.entries.end() && existing->second.size == entry.size &&
+            existing->second.mtime == entry.mtime) {
+            stats.unchanged++;
+            continue;
+        }
+
+        entry.offset = offset;
+        entry.nonce = generated_salt_and_IV(AEAD_NONCE_SIZE);
+        auto fetch = [&](uint8_t* data, uint64_t position, std::size_t length) {
+            return pread_full(in.get(), data, length, position);
+        };
+        if (entry.nonce.empty() ||
+            !seal_segment(c, entry.nonce, c.header_bytes, entry.size, fetch, fd.get(), entry.offset)) {
+            std::cerr << "Error: Failed to add " << source.path << std::endl;
+            ::ftruncate(fd.get(), static_cast<off_t>(c.end));
+            return false;
+        }
+        offset += sealed_length(entry.size, c.header.chunk_size);
+        c.entries[entry.name] = entry;
+        stats.added++;
+    }
+
+    if (stats.added > 0 && !commit_index(fd.get(), c, offset)) {
+        ::ftruncate(fd.get(), static_cast<off_t>(c.end));
+        return false;
+    }
+    fill_stats(c, fd.get(), stats);
+    return true;
+}
+
+bool list_container(const std::string& container, const std::string& password, std::vector<ContainerEntry>& entries) {
+    FileDescriptor fd(::open(container.c_str(), O_RDONLY | O_CLOEXEC));
+    Container c;
+    if (fd.get() < 0 || !load_container(fd.get(), container, password, c)) {
+        return false;
+    }
+    entries.clear();
+    for (const auto& item : c.entries) {
+        entries.push_back(item.second);
+    }
+    return true;
+}
+
+bool extract_container(const std::string& container, const std::string& output_folder, const std::string& password) {
+    FileDescriptor fd(::open(container.c_str(), O_RDONLY | O_CLOEXEC));
+    Container c;
+    if (fd.get() < 0 || !load_container(fd.get(), container, password, c)) {
+        return false;
+    }
+
+    for (const auto& item : c.entries) {
+        const ContainerEntry& entry = item.second;
+        if (!safe_entry_name(entry.name)) {
+            std::cerr << "Error: Unsafe entry name in container: " << entry.name << std::endl;
+            return false;
+        }
+        fs::path target = fs::path(output_folder) / entry.name;
+        std::error_code ec;
+        fs::create_directories(target.parent_path(), ec);
+
+        AtomicFileWriter out;
+        auto write = [&](const uint8_t* data, uint64_t, std::size_t length) {
+            out.stream().write(reinterpret_cast<const char*>(data), length);
+            return static_cast<bool>(out.stream());
+        };
+        if (!out.open(target.string(), entry.size)) {
+            return false;
+        }
+        if (!open_segment(c, entry.nonce, c.header_bytes, entry.size, fd.get(), entry.offset, write)) {
+            std::cerr << "Error: Failed to extract " << entry.name << " (damaged container)" << std::endl;
+            return false;
+        }
+        std::string written = out.commit(PublishMode::REPLACE);
+        if (written.empty()) {
+            return false;
+        }
+
+        struct timespec times[2];
+        times[0].tv_sec = 0;
+        times[0].tv_nsec = UTIME_OMIT;
+        times[1].tv_sec = static_cast<time_t>(entry.mtime / 1000000000ull);
+        times[1].tv_nsec = static_cast<long>(entry.mtime % 1000000000ull);
+        if (::chmod(written.c_str(), entry.mode) != 0 || ::utimensat(AT_FDCWD, written.c_str(), times, 0) != 0) {
+            std::cerr << "Warning: Could not restore mode and time of " << written << std::endl;
+        }
+    }
+    std::cout << c.entries.size() << " files extracted" << std::endl;
+    return true;
+}
+
+bool verify_container(const std::string& container, const std::string& password, ContainerStats& stats) {
+    FileDescriptor fd(::open(container.c_str(), O_RDONLY | O_CLOEXEC));
+    Container c;
+    if (fd.get() < 0 || !load_container(fd.get(), container, password, c)) {
+        return false;
+    }
+
+    auto discard = [](const uint8_t*, uint64_t, std::size_t) { return true; };
+    bool ok = true;
+    for (const auto& item : c.entries) {
+        const ContainerEntry& entry = item.second;
+        if (open_segment(c, entry.nonce, c.header_bytes, entry.size, fd.get(), entry.offset, discard)) {
+            std::cout << "  OK    " << entry.name << " (" << entry.size << " bytes)" << std::endl;
+        } else {
+            std::cout << "  FAIL  " << entry.name << ": authentication failed" << std::endl;
+            ok = false;
+        }
+    }
+    fill_stats(c, fd.get(), stats);
+    return ok;
+}
+
+bool compact_container(const std::string& container, const std::string& password, ContainerStats& stats) {
+    FileDescriptor fd = lock_container(container);
+    Container c;
+    if (fd.get() < 0 || !load_container(fd.get(), container, password, c)) {
+        return false;
+    }
+
+    // Same header, key slots and data key; live segments move down unchanged
+    std::vector<uint8_t> prefix(RECORDS_OFFSET);
+    ContainerStats before;
+    fill_stats(c, fd.get(), before);
+    AtomicFileWriter out;
+    if (!pread_full(fd.get(), prefix.data(), prefix.size(), 0) ||
+        !out.open(container, CONTAINER_DATA_OFFSET + before.live_bytes, FsyncPolicy::PER_FILE)) {
+        return false;
+    }
+    prefix.resize(CONTAINER_DATA_OFFSET, 0);
+    if (!pwrite_full(out.fd(), prefix.data(), prefix.size(), 0)) {
+        return false;
+    }
+
+    uint64_t offset = CONTAINER_DATA_OFFSET;
+    for (auto& item : c.entries) {
+        ContainerEntry& entry = item.second;
+        uint64_t length = sealed_length(entry.size, c.header.chunk_size);
+        if (!copy_range(fd.get(), entry.offset, out.fd(), offset, length)) {
+            std::cerr << "Error: Failed to copy " << entry.name << std::endl;
+            return false;
+        }
+        entry.offset = offset;
+        offset += length;
+    }
+
+    // The new file starts over with record A
+    c.record_slot = 1;
+    if (!commit_index(out.fd(), c, offset) || !out.resize(c.end) || out.commit(PublishMode::REPLACE).empty()) {
+        return false;
+    }
+    fill_stats(c, fd.get(), stats);
+    stats.file_size = c.end;
+    return true;
+}
@@ -0,0 +1,60 @@
+#ifndef CONTAINER_H
+#define CONTAINER_H
+
+// Appendable encrypted containers (layout in internal/format.h).
+//
+// A container keeps every file as its own sealed segment and finds them
+// through an encrypted index at the end. Appending seals only the new or
+// changed files, writes a new index behind them and flips a commit record,
+// so it costs time proportional to the new data. Replaced entries leave
+// their old segments behind as dead space until compact_container copies
+// the live segments, still sealed, into a fresh file.
+
+#include "internal/encryptor.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct ContainerEntry {
+    std::string name;    // Relative path, '/'-separated
+    uint32_t mode = 0;   // Permission bits
+    uint64_t mtime = 0;  // Nanoseconds since the epoch
+    uint64_t size = 0;   // Plaintext bytes
+    uint64_t offset = 0; // Start of the sealed segment
+    std::vector<uint8_t> nonce;
+};
+
+struct ContainerStats {
+    uint64_t added = 0;      // Entries sealed by this run
+    uint64_t unchanged = 0;  // Entries skipped because size and mtime match
+    uint64_t entries = 0;    // Live entries afterwards
+    uint64_t live_bytes = 0; // Sealed bytes of live segments
+    uint64_t file_size = 0;  // Container size afterwards
+};
+
+// True if `path` starts with a container header.
+bool is_container_file(const std::string& path);
+
+// Adds the file or every regular file of the folder `input` to `container`,
+// creating it with `options` if it does not exist. Names are relative to the
+// parent of `input`, as in the ZIP archives of encrypt_path. An entry with the
+// same name is replaced unless its size and mtime are unchanged. Returns
+// false on failure; the container then still holds its previous contents.
+bool append_to_container(const std::string& input, const std::string& container, const std::string& password,
+                         const EncryptOptions& options, ContainerStats& stats);
+
+// Lists the live entries, ordered by name.
+bool list_container(const std::string& container, const std::string& password, std::vector<ContainerEntry>& entries);
+
+// Writes every live entry below `output_folder`, restoring mode and mtime.
+bool extract_container(const std::string& container, const std::string& output_folder, const std::string& password);
+
+// Authenticates every live segment without writing anything.
+bool verify_container(const std::string& container, const std::string& password, ContainerStats& stats);
+
+// Rewrites `container` with only its live segments, copied without
+// re-encryption, and atomically replaces it.
+bool compact_container(const std::string& container, const std::string& password, ContainerStats& stats);
+
+#endif // CONTAINER_H
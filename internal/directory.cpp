@@ -0,0 +1,32 @@
+#include "internal/directory.h"
+
+#include <string_view>
+
+std::string find_redundant_prefix(const std::vector<std::string>& entries) {
+    std::string prefix;
+    while (true) {
+        std::string_view single_folder;
+        bool has_content = false;
+
+        for (const auto& entry : entries) {
+            std::string_view rest(entry);
+            if (rest.compare(0, prefix.size(), prefix) != 0) return prefix;
+            rest.remove_prefix(prefix.size());
+            if (rest.empty()) continue;  // Directory entry of the prefix itself
+
+            std::size_t slash = rest.find('/');
+            if (slash == std::string_view::npos) return prefix;  // A file at this level
+
+            std::string_view folder = rest.substr(0, slash + 1);
+            if (single_folder.empty()) {
+                single_folder = folder;
+            } else if (folder != single_folder) {
+                return prefix;
+            }
+            if (rest.size() > folder.size()) has_content = true;
+        }
+
+        if (single_folder.empty() || !has_content) return prefix;
+        prefix += single_folder;
+    }
+}
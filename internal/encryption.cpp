@@ -0,0 +1,239 @@
+#include "internal/encryption.h"
+#include "internal/output.h"
+#include "internal/pool.h"
+
+#include <stdexcept>
+
+
+std::vector<uint8_t> generated_salt_and_IV(int length){
+    std::vector<uint8_t> random(length);
+    if(!RAND_bytes(random.data(), length)){
+        std::cerr << "Error: Failed to generate cryptographically secure random bytes. "
+                  << "OpenSSL RAND_bytes() failed." << std::endl;
+        return {};
+    }
+    return random;
+}
+
+SecureBytes generated_key(int length) {
+    SecureBytes key(length);
+    if (!RAND_bytes(key.data(), length)) {
+        std::cerr << "Error: Failed to generate cryptographically secure random bytes. "
+                  << "OpenSSL RAND_bytes() failed." << std::endl;
+        return {};
+    }
+    return key;
+}
+
+namespace {
+
+std::string to_hex(const std::vector<uint8_t>& bytes) {
+    static const char digits[] = "0123456789abcdef";
+    std::string hex;
+    hex.reserve(bytes.size() * 2);
+    for (uint8_t b : bytes) {
+        hex.push_back(digits[b >> 4]);
+        hex.push_back(digits[b & 0x0f]);
+    }
+    return hex;
+}
+
+} // namespace
+
+std::string make_temp_path(const std::string& base) {
+    std::vector<uint8_t> suffix = generated_salt_and_IV(8);
+    if (suffix.empty()) {
+        throw std::runtime_error("Failed to generate temporary file name for: " + base);
+    }
+    return base + ".tmp." + to_hex(suffix);
+}
+
+SecureBytes key_gene(const std::string& password, const std::vector<uint8_t>& salt, int length, int iterations, int keysize){
+    SecureBytes key(keysize);
+    if(!PKCS5_PBKDF2_HMAC(password.c_str(), password.length(), salt.data(), length, iterations, EVP_sha256(), keysize, key.data())){
+        std::cerr << "Error: PBKDF2 key derivation failed. "
+                  << "Password: " << password.length() << " chars, "
+                  << "Iterations: " << iterations << ", "
+                  << "Key size: " << keysize << " bytes" << std::endl;
+        return {};
+    }
+    return key;   
+}
+
+std::vector<uint8_t> encryption_aes_256(const SecureBytes& plaintext, const SecureBytes& key, const std::vector<uint8_t>& IV){
+    PooledCipherContext pooled_ctx;
+    EVP_CIPHER_CTX* ctx = pooled_ctx.get();
+    if (!ctx) {
+        std::cerr << "Error: Failed to create encryption context." << std::endl;
+        return {};
+    }
+
+    if (EVP_EncryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), IV.data()) != 1) {
+        std::cerr << "Error: Encryption initialization failed." << std::endl;
+        return {};
+    }
+
+    std::vector<uint8_t> ciphertext(plaintext.size() + EVP_MAX_BLOCK_LENGTH);
+
+    int len;
+    int ciphertext_len = 0;
+
+    if (EVP_EncryptUpdate(ctx, ciphertext.data(), &len, plaintext.data(), plaintext.size()) != 1) {
+        std::cerr << "Error: Encryption update failed." << std::endl;
+        return {};
+    }
+
+    ciphertext_len = len;
+
+    if (EVP_EncryptFinal_ex(ctx, ciphertext.data() + ciphertext_len, &len) != 1) {
+        std::cerr << "Error: Encryption finalization failed." << std::endl;
+        return {};
+    }
+
+    ciphertext_len += len;
+    ciphertext.resize(ciphertext_len);
+
+    return ciphertext;
+
+
+}
+
+SecureBytes read_a_file(const std::string& file_path){
+    std::ifstream file(file_path, std::ios::binary);
+    if(!file){
+        std::cerr << "Error: file not found";
+        return {};
+    }
+    file.seekg(0, std::ios::end);
+    std::streamsize file_size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    SecureBytes read(file_size);
+
+
+    file.read(reinterpret_cast<char* >(read.data()),file_size);
+
+       return read;
+}
+
+std::string create_new_file(const std::string& path_file, std::vector<uint8_t> data) {
+    AtomicFileWriter file;
+    if (!file.open(path_file, data.size())) {
+        throw std::runtime_error("Failed to create file: " + path_file);
+    }
+
+    file.stream().write(reinterpret_cast<const char*>(data.data()), data.size());
+    std::string new_path = file.commit();
+    if (new_path.empty()) {
+        throw std::runtime_error("Failed to write file: " + path_file);
+    }
+    return new_path;
+}
+
+
+
+
+SecureBytes decrypt_aes_256(const std::vector<uint8_t>& encrypted_data, const std::string& password, int iterations) {
+    if (encrypted_data.size() < 32) {
+        std::cerr << "Error: Encrypted data is too short." << std::endl;
+        return {};
+    }
+
+    std::vector<uint8_t> salt(encrypted_data.begin(), encrypted_data.begin() + 16);
+    std::vector<uint8_t> iv(encrypted_data.begin() + 16, encrypted_data.begin() + 32);
+    std::vector<uint8_t> ciphertext(encrypted_data.begin() + 32, encrypted_data.end());
+
+    SecureBytes key(32);
+    if (!PKCS5_PBKDF2_HMAC(password.c_str(), password.length(), salt.data(), salt.size(), iterations, EVP_sha256(), key.size(), key.data())) {
+        std::cerr << "Error: Key derivation failed." << std::endl;
+        return {};
+    }
+
+    PooledCipherContext pooled_ctx;
+    EVP_CIPHER_CTX* ctx = pooled_ctx.get();
+    if (!ctx) {
+        std::cerr << "Error: Failed to create context." << std::endl;
+        return {};
+    }
+
+    if (EVP_DecryptInit_ex(ctx, EVP_aes_256_cbc(), nullptr, key.data(), iv.data()) != 1) {
+        std::cerr << "Error: Decryption initialization failed." << std::endl;
+        return {};
+    }
+
+    EVP_CIPHER_CTX_set_padding(ctx, 0);
+
+    SecureBytes plaintext(ciphertext.size() + EVP_MAX_BLOCK_LENGTH);
+    int len;
+    int plaintext_len = 0;
+
+    if (EVP_DecryptUpdate(ctx, plaintext.data(), &len, ciphertext.data(), ciphertext.size()) != 1) {
+        std::cerr << "Error: Decryption failed." << std::endl;
+        return {};
+    }
+    plaintext_len = len;
+
+    if (EVP_DecryptFinal_ex(ctx, plaintext.data() + plaintext_len, &len) != 1) {
+        std::cerr << "Error: Final decryption step failed." << std::endl;
+        return {};
+    }
+    plaintext_len += len;
+
+    plaintext.resize(plaintext_len);
+
+    // Search the delimiter in place rather than in a string copy of the plaintext
+    const std::string delimiter = "::END::";
+    auto pos = std::search(plaintext.begin(), plaintext.end(), delimiter.begin(), delimiter.end());
+    if (pos == plaintext.end()) {
+        std::cerr << "Error: Decryption verification failed." << std::endl;
+        return {};
+    }
+
+    // Remove the delimiter and return the original plaintext, still in locked memory
+    plaintext.erase(pos, plaintext.end());
+    return plaintext;
+}
+
+
+std::vector<uint8_t> final_encrypt(const std::string& password, int iterations, int keysize, const std::string& input) {
+    std::vector<uint8_t> salt = generated_salt_and_IV(16);
+    if (salt.empty()) {
+        std::cerr << "Error: Failed to generate salt" << std::endl;
+        return {};
+    }
+    
+    SecureBytes derived_key = key_gene(password, salt, salt.size(), iterations, keysize);
+    if (derived_key.empty()) {
+        std::cerr << "Error: Failed to derive key" << std::endl;
+        return {};
+    }
+
+    std::vector<uint8_t> IV = generated_salt_and_IV(16);
+    if (IV.empty()) {
+        std::cerr << "Error: Failed to generate IV" << std::endl;
+        return {};
+    }
+    
+    SecureBytes plaintext = read_a_file(input);
+    if (plaintext.empty()) {
+        std::cerr << "Error: Failed to read input file or file is empty" << std::endl;
+        return {};
+    }
+
+    // Append a known delimiter and string to the plaintext
+    std::string delimiter = "::END::";
+    plaintext.insert(plaintext.end(), delimiter.begin(), delimiter.end());
+
+    std::vector<uint8_t> ciphertext = encryption_aes_256(plaintext, derived_key, IV);
+    if (ciphertext.empty()) {
+        std::cerr << "Error: Encryption failed" << std::endl;
+        return {};
+    }
+
+    std::vector<uint8_t> final_output;
+    final_output.insert(final_output.end(), salt.begin(), salt.end());
+    final_output.insert(final_output.end(), IV.begin(), IV.end());
+    final_output.insert(final_output.end(), ciphertext.begin(), ciphertext.end());
+
+    return final_output;
+}
@@ -0,0 +1,402 @@
+#include "internal/encryptor.h"
+
+#include "internal/encryption.h"
+#include "internal/format.h"
+#include "internal/keyslot.h"
+#include "internal/output.h"
+#include "internal/pool.h"
+#include "internal/zip.h"
+
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// Marker appended to the plaintext by legacy files (see final_encrypt).
+const char END_DELIMITER[] = "::END::";
+constexpr std::size_t END_DELIMITER_SIZE = sizeof(END_DELIMITER) - 1;
+
+// Writes decrypted output while holding back the last END_DELIMITER_SIZE bytes,
+// which must turn out to be the delimiter once the stream is finished.
+class DelimitedWriter {
+public:
+    explicit DelimitedWriter(std::ostream& out) : out_(out) {}
+
+    void write(const uint8_t* data, std::size_t size) {
+        if (size >= END_DELIMITER_SIZE) {
+            flush_tail(tail_.size());
+            std::size_t body = size - END_DELIMITER_SIZE;
+            out_.write(reinterpret_cast<const char*>(data), body);
+            tail_.assign(data + body, data + size);
+            return;
+        }
+        tail_.insert(tail_.end(), data, data + size);
+        if (tail_.size() > END_DELIMITER_SIZE) {
+            flush_tail(tail_.size() - END_DELIMITER_SIZE);
+        }
+    }
+
+    bool finish() {
+        bool verified = tail_.size() == END_DELIMITER_SIZE &&
+                        std::memcmp(tail_.data(), END_DELIMITER, END_DELIMITER_SIZE) == 0;
+        secure_clear(tail_);
+        out_.flush();
+        return verified && static_cast<bool>(out_);
+    }
+
+private:
+    void flush_tail(std::size_t count) {
+        out_.write(reinterpret_cast<const char*>(tail_.data()), count);
+        tail_.erase(tail_.begin(), tail_.begin() + count);
+    }
+
+    std::ostream& out_;
+    SecureBytes tail_;
+};
+
+// Reads the pre-header [salt][IV][AES-256-CBC] layout. `prefix` holds the
+// salt and IV already consumed from `in`.
+bool decrypt_legacy_stream(const std::vector<uint8_t>& prefix, std::istream& in, std::ostream& out,
+                           const std::string& password) {
+    std::vector<uint8_t> salt(prefix.begin(), prefix.begin() + SALT_SIZE);
+    std::vector<uint8_t> iv(prefix.begin() + SALT_SIZE, prefix.begin() + SALT_SIZE + IV_SIZE);
+
+    SecureBytes key = key_gene(password, salt, salt.size(), LEGACY_PBKDF2_ITERATIONS, KEY_SIZE);
+    if (key.empty()) {
+        std::cerr << "Error: Key derivation failed." << std::endl;
+        return false;
+    }
+
+    PooledCipherContext ctx;
+    if (!ctx.valid()) {
+        std::cerr << "Error: Failed to create context." << std::endl;
+        secure_clear(key);
+        return false;
+    }
+
+    int init_ok = EVP_DecryptInit_ex(ctx.get(), EVP_aes_256_cbc(), nullptr, key.data(), iv.data());
+    secure_clear(key);
+    if (init_ok != 1) {
+        std::cerr << "Error: Decryption initialization failed." << std::endl;
+        return false;
+    }
+
+    DelimitedWriter writer(out);
+    PooledBuffer in_buf(STREAM_BUFFER_SIZE);
+    PooledBuffer out_buf(STREAM_BUFFER_SIZE + EVP_MAX_BLOCK_LENGTH);
+    int len = 0;
+
+    while (in) {
+        in.read(reinterpret_cast<char*>(in_buf.data()), in_buf.size());
+        std::streamsize got = in.gcount();
+        if (got <= 0) break;
+
+        if (EVP_DecryptUpdate(ctx.get(), out_buf.data(), &len, in_buf.data(), static_cast<int>(got)) != 1) {
+            std::cerr << "Error: Decryption failed." << std::endl;
+            return false;
+        }
+        writer.write(out_buf.data(), len);
+    }
+
+    if (in.bad()) {
+        std::cerr << "Error: Failed to read encrypted input" << std::endl;
+        return false;
+    }
+
+    if (EVP_DecryptFinal_ex(ctx.get(), out_buf.data(), &len) != 1) {
+        std::cerr << "Error: Final decryption step failed." << std::endl;
+        return false;
+    }
+    writer.write(out_buf.data(), len);
+
+    if (!writer.finish()) {
+        std::cerr << "Error: Decryption verification failed." << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Reads until `size` bytes arrived or the stream ended; returns the count read.
+std::size_t read_full(std::istream& in, uint8_t* data, std::size_t size) {
+    std::size_t total = 0;
+    while (total < size && in) {
+        in.read(reinterpret_cast<char*>(data + total), size - total);
+        total += static_cast<std::size_t>(in.gcount());
+    }
+    return total;
+}
+
+} // namespace
+
+bool new_file_header(const EncryptOptions& options, FileHeader& header) {
+    const CipherSuiteInfo* suite = find_cipher_suite(options.suite);
+    if (!suite || !cipher_suite_available(*suite)) {
+        std::cerr << "Error: Cipher suite is not available for encryption." << std::endl;
+        return false;
+    }
+    if (options.chunk_size == 0 || options.chunk_size > MAX_CHUNK_SIZE) {
+        std::cerr << "Error: Invalid chunk size: " << options.chunk_size << std::endl;
+        return false;
+    }
+
+    header = FileHeader();
+    header.suite = suite->id;
+    header.chunk_size = options.chunk_size;
+    header.kdf = options.kdf;
+    header.flags = HEADER_FLAG_KEY_SLOTS | (options.raw_payload ? HEADER_FLAG_RAW_PAYLOAD : 0);
+    if (!options.salt.empty() && options.salt.size() != SALT_SIZE) {
+        std::cerr << "Error: Salt must be " << SALT_SIZE << " bytes." << std::endl;
+        return false;
+    }
+    header.salt = options.salt.empty() ? generated_salt_and_IV(SALT_SIZE) : options.salt;
+    header.nonce = generated_salt_and_IV(AEAD_NONCE_SIZE);
+    if (header.salt.empty() || header.nonce.empty()) {
+        std::cerr << "Error: Failed to generate salt or nonce" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool encrypt_stream(std::istream& in, std::ostream& out, const std::string& password,
+                    const EncryptOptions& options, KeyCache* keys) {
+    FileHeader header;
+    if (!new_file_header(options, header)) {
+        return false;
+    }
+
+    SecureBytes key = new_data_key(header, password, keys);
+    if (key.empty()) {
+        return false;
+    }
+
+    std::vector<uint8_t> header_bytes = serialize_header(header);
+    ChunkCipher cipher;
+    bool init_ok = cipher.init(*find_cipher_suite(header.suite), key, header.nonce, header_bytes, true);
+    secure_clear(key);
+    if (!init_ok) {
+        return false;
+    }
+
+    std::vector<uint8_t> key_slots = serialize_key_slots(header);
+    out.write(reinterpret_cast<const char*>(header_bytes.data()), header_bytes.size());
+    out.write(reinterpret_cast<const char*>(key_slots.data()), key_slots.size());
+
+    // One chunk of read-ahead tells us which chunk is the final one.
+    const std::size_t chunk_size = header.chunk_size;
+    PooledBuffer current(chunk_size);
+    PooledBuffer next(chunk_size);
+    PooledBuffer sealed(chunk_size + AEAD_TAG_SIZE);
+    std::size_t current_len = read_full(in, current.data(), chunk_size);
+
+    for (uint64_t index = 0;; ++index) {
+        std::size_t next_len = current_len == chunk_size ? read_full(in, next.data(), chunk_size) : 0;
+        if (in.bad()) {
+            std::cerr << "Error: Failed to read plaintext input" << std::endl;
+            return false;
+        }
+
+        bool final = next_len == 0;
+        if (!cipher.seal(index, final, current.data(), current_len, sealed.data())) {
+            std::cerr << "Error: Encryption failed at chunk " << index << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(sealed.data()), current_len + AEAD_TAG_SIZE);
+        if (final) break;
+
+        current.swap(next);
+        current_len = next_len;
+    }
+
+    out.flush();
+    if (!out) {
+        std::cerr << "Error: Failed to write encrypted output" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool decrypt_stream(std::istream& in, std::ostream& out, const std::string& password,
+                    FileHeader* header_out, KeyCache* keys) {
+    std::vector<uint8_t> header_bytes(LEGACY_HEADER_SIZE);
+    if (read_full(in, header_bytes.data(), header_bytes.size()) != header_bytes.size()) {
+        std::cerr << "Error: Encrypted data is too short." << std::endl;
+        return false;
+    }
+    if (!has_file_magic(header_bytes.data(), header_bytes.size())) {
+        if (header_out) {
+            *header_out = FileHeader();
+            header_out->version = LEGACY_FORMAT_VERSION;
+            header_out->suite = CipherSuite::AES_256_CBC;
+        }
+        return decrypt_legacy_stream(header_bytes, in, out, password);
+    }
+
+    header_bytes.resize(FILE_HEADER_SIZE);
+    std::size_t rest = FILE_HEADER_SIZE - LEGACY_HEADER_SIZE;
+    FileHeader header;
+    if (read_full(in, header_bytes.data() + LEGACY_HEADER_SIZE, rest) != rest ||
+        !parse_header(header_bytes, header)) {
+        std::cerr << "Error: Invalid file header." << std::endl;
+        return false;
+    }
+    if (header.flags & HEADER_FLAG_CONTAINER) {
+        std::cerr << "Error: This is an appendable container; decrypt it with -i <file> -o <folder> -d." << std::endl;
+        return false;
+    }
+    if (header.flags & HEADER_FLAG_KEY_SLOTS) {
+        std::vector<uint8_t> key_slots(KEY_SLOTS_SIZE);
+        if (read_full(in, key_slots.data(), key_slots.size()) != key_slots.size() ||
+            !parse_key_slots(key_slots.data(), key_slots.size(), header)) {
+            std::cerr << "Error: Invalid key slots." << std::endl;
+            return false;
+        }
+    }
+    if (header_out) {
+        *header_out = header;
+    }
+
+    SecureBytes key = unlock_file_key(header, password, keys);
+    if (key.empty()) {
+        return false;
+    }
+
+    ChunkCipher cipher;
+    bool init_ok = cipher.init(*find_cipher_suite(header.suite), key, header.nonce, header_bytes, false);
+    secure_clear(key);
+    if (!init_ok) {
+        return false;
+    }
+
+    const std::size_t sealed_size = header.chunk_size + AEAD_TAG_SIZE;
+    PooledBuffer current(sealed_size);
+    PooledBuffer next(sealed_size);
+    PooledBuffer plain(header.chunk_size);
+    std::size_t current_len = read_full(in, current.data(), sealed_size);
+
+    for (uint64_t index = 0;; ++index) {
+        if (current_len < static_cast<std::size_t>(AEAD_TAG_SIZE)) {
+            std::cerr << "Error: Encrypted data is truncated." << std::endl;
+            return false;
+        }
+
+        std::size_t next_len = current_len == sealed_size ? read_full(in, next.data(), sealed_size) : 0;
+        if (in.bad()) {
+            std::cerr << "Error: Failed to read encrypted input" << std::endl;
+            return false;
+        }
+
+        bool final = next_len == 0;
+        if (!cipher.open(index, final, current.data(), current_len, plain.data())) {
+            std::cerr << "Error: Authentication failed at chunk " << index << std::endl;
+            return false;
+        }
+        out.write(reinterpret_cast<const char*>(plain.data()), current_len - AEAD_TAG_SIZE);
+        if (final) break;
+
+        current.swap(next);
+        current_len = next_len;
+    }
+
+    out.flush();
+    if (!out) {
+        std::cerr << "Error: Failed to write decrypted output" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool archive_path(const std::string& input, const std::string& zip_path) {
+    int file_or_folder = is_file_or_folder(input);
+    if (file_or_folder == 1) {
+        return zip_file(input, zip_path);
+    }
+    if (file_or_folder == 0) {
+        return zip_folder(input, zip_path);
+    }
+    std::cerr << "Error: Invalid input type" << std::endl;
+    return false;
+}
+
+
+std::string encrypt_path(const std::string& input, const std::string& output_file, const std::string& password,
+                         const EncryptOptions& options) {
+    std::string temp_zip = make_temp_path(input) + ".zip";
+    if (!archive_path(input, temp_zip)) {
+        std::cerr << "Error: Failed to create zip file" << std::endl;
+        delete_zip(temp_zip);
+        return "";
+    }
+
+    std::ifstream in(temp_zip, std::ios::binary);
+    std::error_code size_error;
+    uint64_t zip_size = fs::file_size(temp_zip, size_error);
+    if (!in || size_error) {
+        std::cerr << "Error: Failed to open zip file: " << temp_zip << std::endl;
+        delete_zip(temp_zip);
+        return "";
+    }
+
+    AtomicFileWriter out;
+    if (!out.open(output_file, encrypted_size(zip_size, options.chunk_size))) {
+        delete_zip(temp_zip);
+        return "";
+    }
+
+    bool ok = encrypt_stream(in, out.stream(), password, options);
+    in.close();
+    delete_zip(temp_zip);
+
+    if (!ok) {
+        return "";
+    }
+    return out.commit();
+}
+
+bool decrypt_path(const std::string& input, const std::string& output_folder, const std::string& password) {
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::cerr << "Error: Failed to read encrypted file: " << input << std::endl;
+        return false;
+    }
+
+    // Decrypt into an unpublished file in the output folder. Raw payloads are
+    // published from there as-is; ZIP payloads are extracted and discarded.
+    fs::path name = fs::path(input).filename();
+    if (name.extension() == ".enc") name.replace_extension();
+    try {
+        fs::create_directories(output_folder);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error: Could not create output directory: " << e.what() << std::endl;
+        return false;
+    }
+
+    std::error_code size_error;
+    uint64_t input_size = fs::file_size(input, size_error);
+    AtomicFileWriter out;
+    if (!out.open((fs::path(output_folder) / name).string(), size_error ? 0 : input_size)) {
+        return false;
+    }
+
+    FileHeader header;
+    bool ok = decrypt_stream(in, out.stream(), password, &header);
+    out.stream().flush();
+    if (!ok || !out.stream()) {
+        std::cerr << "Error: Decryption failed - wrong password or corrupted file" << std::endl;
+        return false;
+    }
+
+    if (header.flags & HEADER_FLAG_RAW_PAYLOAD) {
+        std::string target = out.commit();
+        if (target.empty()) {
+            return false;
+        }
+        std::cout << "Raw payload written: " << target << std::endl;
+        return true;
+    }
+
+    if (!unzip_file(out.read_path(), output_folder, true)) {
+        std::cerr << "Error: Failed to extract files" << std::endl;
+        return false;
+    }
+    return true;
+}
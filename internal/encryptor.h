@@ -0,0 +1,68 @@
+#ifndef ENCRYPTOR_H
+#define ENCRYPTOR_H
+
+// In-process API of libencryptor.
+//
+// Calls on different files may run concurrently from several threads
+// without external locking: temporary files are private to the call, cipher
+// contexts and buffers come from per-thread pools (internal/pool.h), and
+// outputs claim their names atomically. Some state is process-wide, though:
+// set_default_fsync_policy changes the policy of every later call, and
+// batched outputs share one sync batch (internal/output.h). Paths are used
+// as given; "~" is not expanded.
+
+#include "internal/cipher.h"
+#include "internal/encryption.h"
+#include "internal/format.h"
+#include "internal/kdf.h"
+
+#include <cstddef>
+#include <istream>
+#include <ostream>
+#include <string>
+
+struct EncryptOptions {
+    CipherSuite suite = default_cipher_suite();
+    uint32_t chunk_size = STREAM_BUFFER_SIZE;
+    KdfParams kdf;
+    bool raw_payload = false;  // Mark the payload as a plain byte stream rather than a ZIP
+    std::vector<uint8_t> salt; // Fixed salt (SALT_SIZE bytes) to share a KeyCache entry; random if empty
+};
+
+// Fills a new header for `options` with a random salt and base nonce. New
+// headers always announce key slots (see internal/keyslot.h).
+bool new_file_header(const EncryptOptions& options, FileHeader& header);
+
+// Reads plaintext from `in` until EOF and writes the chunked format described
+// in internal/format.h to `out`, sealing the chunks with a random data key
+// held in key slot 0. The KDF parameters are recorded in the header. With
+// `keys`, the password-derived key is taken from / stored in that cache.
+bool encrypt_stream(std::istream& in, std::ostream& out, const std::string& password,
+                    const EncryptOptions& options = EncryptOptions(), KeyCache* keys = nullptr);
+
+// Reverse of encrypt_stream; also reads legacy [salt][IV][CBC] files. The
+// cipher suite and KDF parameters are taken from the file header. Returns false on a wrong
+// password or corrupted input; `out` may then hold a partial plaintext and
+// should be discarded. Memory use is bounded by the chunk size, so `in` and
+// `out` may be pipes of any length. If `header` is given it receives the
+// parsed file header (version LEGACY_FORMAT_VERSION for legacy files).
+// With `keys`, key slots (or files) sharing salt and KDF parameters derive
+// their key once.
+bool decrypt_stream(std::istream& in, std::ostream& out, const std::string& password,
+                    FileHeader* header = nullptr, KeyCache* keys = nullptr);
+
+// Compresses a file or folder into a ZIP archive at `zip_path`.
+bool archive_path(const std::string& input, const std::string& zip_path);
+
+// Archives and encrypts `input`. The result is written to `output_file`, or to
+// the first free `output_file_N` if that name is taken. Returns the path that
+// was written, or an empty string on failure.
+std::string encrypt_path(const std::string& input, const std::string& output_file, const std::string& password,
+                         const EncryptOptions& options = EncryptOptions());
+
+// Decrypts an archive produced by encrypt_path and extracts it into `output_folder`.
+// Raw payloads (see EncryptOptions::raw_payload) are written to a file named
+// after `input` without its .enc extension instead.
+bool decrypt_path(const std::string& input, const std::string& output_folder, const std::string& password);
+
+#endif // ENCRYPTOR_H
@@ -0,0 +1,202 @@
+#include "internal/format.h"
+
+#include <cstring>
+
+void put_u32(uint8_t* out, uint32_t value) {
+    out[0] = static_cast<uint8_t>(value >> 24);
+    out[1] = static_cast<uint8_t>(value >> 16);
+    out[2] = static_cast<uint8_t>(value >> 8);
+    out[3] = static_cast<uint8_t>(value);
+}
+
+uint32_t get_u32(const uint8_t* in) {
+    return (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16) |
+           (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+}
+
+void put_u64(uint8_t* out, uint64_t value) {
+    put_u32(out, static_cast<uint32_t>(value >> 32));
+    put_u32(out + 4, static_cast<uint32_t>(value));
+}
+
+uint64_t get_u64(const uint8_t* in) {
+    return (static_cast<uint64_t>(get_u32(in)) << 32) | get_u32(in + 4);
+}
+
+std::size_t header_size(uint8_t flags) {
+    return FILE_HEADER_SIZE + ((flags & HEADER_FLAG_KEY_SLOTS) ? KEY_SLOTS_SIZE : 0);
+}
+
+uint64_t key_slot_offset(std::size_t index) {
+    return FILE_HEADER_SIZE + index * KEY_SLOT_SIZE;
+}
+
+uint64_t chunk_offset(const FileHeader& header, uint64_t index) {
+    return header_size(header.flags) + index * (static_cast<uint64_t>(header.chunk_size) + AEAD_TAG_SIZE);
+}
+
+bool chunk_layout(uint64_t payload_size, uint32_t chunk_size, uint64_t& chunks, uint64_t& last_sealed) {
+    uint64_t sealed_size = static_cast<uint64_t>(chunk_size) + AEAD_TAG_SIZE;
+    chunks = (payload_size + sealed_size - 1) / sealed_size;
+    last_sealed = chunks ? payload_size - (chunks - 1) * sealed_size : 0;
+    return chunks > 0 && last_sealed >= AEAD_TAG_SIZE;
+}
+
+uint64_t encrypted_size(uint64_t plain_size, uint32_t chunk_size) {
+    uint64_t chunks = plain_size == 0 ? 1 : (plain_size + chunk_size - 1) / chunk_size;
+    return header_size(HEADER_FLAG_KEY_SLOTS) + plain_size + chunks * AEAD_TAG_SIZE;
+}
+
+bool has_file_magic(const uint8_t* data, std::size_t size) {
+    return size >= sizeof(FILE_MAGIC) && std::memcmp(data, FILE_MAGIC, sizeof(FILE_MAGIC)) == 0;
+}
+
+std::vector<uint8_t> serialize_header(const FileHeader& header) {
+    std::vector<uint8_t> out(FILE_HEADER_SIZE, 0);
+    std::memcpy(out.data(), FILE_MAGIC, sizeof(FILE_MAGIC));
+    out[4] = header.version;
+    out[5] = static_cast<uint8_t>(header.suite);
+    out[6] = static_cast<uint8_t>(header.kdf.id);
+    out[7] = header.flags;
+    put_u32(out.data() + 8, header.chunk_size);
+    put_u32(out.data() + 12, header.kdf.iterations);
+    put_u32(out.data() + 16, header.kdf.memory_kib);
+    put_u32(out.data() + 20, header.kdf.lanes);
+    std::copy(header.salt.begin(), header.salt.end(), out.begin() + 24);
+    std::copy(header.nonce.begin(), header.nonce.end(), out.begin() + 24 + SALT_SIZE);
+    return out;
+}
+
+std::vector<uint8_t> serialize_key_slot(const KeySlot& slot) {
+    std::vector<uint8_t> out(KEY_SLOT_SIZE, 0);
+    if (!slot.active) {
+        return out;
+    }
+    out[0] = 1;
+    out[1] = static_cast<uint8_t>(slot.kdf.id);
+    put_u32(out.data() + 4, slot.kdf.iterations);
+    put_u32(out.data() + 8, slot.kdf.memory_kib);
+    put_u32(out.data() + 12, slot.kdf.lanes);
+    std::copy(slot.salt.begin(), slot.salt.end(), out.begin() + 16);
+    std::copy(slot.nonce.begin(), slot.nonce.end(), out.begin() + 16 + SALT_SIZE);
+    std::copy(slot.wrapped_key.begin(), slot.wrapped_key.end(), out.begin() + KEY_SLOT_PARAMS_SIZE);
+    return out;
+}
+
+std::vector<uint8_t> serialize_key_slots(const FileHeader& header) {
+    std::vector<uint8_t> out;
+    out.reserve(KEY_SLOTS_SIZE);
+    for (std::size_t i = 0; i < KEY_SLOT_COUNT; ++i) {
+        std::vector<uint8_t> slot = i < header.key_slots.size() ? serialize_key_slot(header.key_slots[i])
+                                                                : std::vector<uint8_t>(KEY_SLOT_SIZE, 0);
+        out.insert(out.end(), slot.begin(), slot.end());
+    }
+    return out;
+}
+
+bool parse_key_slots(const uint8_t* data, std::size_t size, FileHeader& header) {
+    if (size < KEY_SLOTS_SIZE) {
+        std::cerr << "Error: Key slots are truncated." << std::endl;
+        return false;
+    }
+    header.key_slots.assign(KEY_SLOT_COUNT, KeySlot());
+    for (std::size_t i = 0; i < KEY_SLOT_COUNT; ++i) {
+        const uint8_t* in = data + i * KEY_SLOT_SIZE;
+        if (in[0] == 0) continue;
+
+        KeySlot& slot = header.key_slots[i];
+        slot.active = in[0] == 1;
+        slot.kdf.id = static_cast<KdfId>(in[1]);
+        slot.kdf.iterations = get_u32(in + 4);
+        slot.kdf.memory_kib = get_u32(in + 8);
+        slot.kdf.lanes = get_u32(in + 12);
+        if (!slot.active || !validate_kdf_params(slot.kdf)) {
+            std::cerr << "Error: Invalid key slot " << i << "." << std::endl;
+            return false;
+        }
+        slot.salt.assign(in + 16, in + 16 + SALT_SIZE);
+        slot.nonce.assign(in + 16 + SALT_SIZE, in + KEY_SLOT_PARAMS_SIZE);
+        slot.wrapped_key.assign(in + KEY_SLOT_PARAMS_SIZE, in + KEY_SLOT_PARAMS_SIZE + KEY_SIZE + AEAD_TAG_SIZE);
+    }
+    return true;
+}
+
+std::vector<uint8_t> serialize_volume_header(const VolumeHeader& header) {
+    std::vector<uint8_t> out(VOLUME_HEADER_SIZE + header.key_slots.size(), 0);
+    std::memcpy(out.data(), VOLUME_MAGIC, sizeof(VOLUME_MAGIC));
+    out[4] = FORMAT_VERSION;
+    put_u32(out.data() + 8, header.index);
+    put_u32(out.data() + 12, header.count);
+    put_u64(out.data() + 16, header.first_chunk);
+    put_u64(out.data() + 24, header.chunks);
+    std::copy(header.file_header.begin(), header.file_header.end(), out.begin() + 32);
+    std::copy(header.key_slots.begin(), header.key_slots.end(), out.begin() + VOLUME_HEADER_SIZE);
+    return out;
+}
+
+bool parse_volume_header(const uint8_t* data, std::size_t size, VolumeHeader& header) {
+    if (size < VOLUME_HEADER_SIZE || std::memcmp(data, VOLUME_MAGIC, sizeof(VOLUME_MAGIC)) != 0 ||
+        data[4] != FORMAT_VERSION) {
+        return false;
+    }
+    header.index = get_u32(data + 8);
+    header.count = get_u32(data + 12);
+    header.first_chunk = get_u64(data + 16);
+    header.chunks = get_u64(data + 24);
+    header.file_header.assign(data + 32, data + VOLUME_HEADER_SIZE);
+    header.key_slots.clear();
+    if (header.file_header[7] & HEADER_FLAG_KEY_SLOTS) {
+        if (size < VOLUME_HEADER_SIZE + KEY_SLOTS_SIZE) return false;
+        header.key_slots.assign(data + VOLUME_HEADER_SIZE, data + VOLUME_HEADER_SIZE + KEY_SLOTS_SIZE);
+    }
+    return header.index < header.count && header.chunks > 0 &&
+           has_file_magic(header.file_header.data(), header.file_header.size());
+}
+
+std::size_t volume_header_size(const VolumeHeader& header) {
+    return VOLUME_HEADER_SIZE + header.key_slots.size();
+}
+
+bool parse_header(const std::vector<uint8_t>& bytes, FileHeader& header) {
+    if (bytes.size() < FILE_HEADER_SIZE || !has_file_magic(bytes.data(), bytes.size())) {
+        std::cerr << "Error: Not an encrypted file." << std::endl;
+        return false;
+    }
+    if (bytes[4] != FORMAT_VERSION) {
+        std::cerr << "Error: Unsupported file format version " << static_cast<int>(bytes[4]) << std::endl;
+        return false;
+    }
+
+    header.version = bytes[4];
+    header.suite = static_cast<CipherSuite>(bytes[5]);
+    const CipherSuiteInfo* suite = find_cipher_suite(header.suite);
+    if (!suite || !cipher_suite_available(*suite)) {
+        std::cerr << "Error: Unsupported cipher suite " << static_cast<int>(bytes[5]) << std::endl;
+        return false;
+    }
+
+    header.flags = bytes[7];
+    if (header.flags & ~HEADER_KNOWN_FLAGS) {
+        std::cerr << "Error: Unsupported header flags." << std::endl;
+        return false;
+    }
+
+    header.chunk_size = get_u32(bytes.data() + 8);
+    if (header.chunk_size == 0 || header.chunk_size > MAX_CHUNK_SIZE) {
+        std::cerr << "Error: Invalid chunk size in header." << std::endl;
+        return false;
+    }
+
+    header.kdf.id = static_cast<KdfId>(bytes[6]);
+    header.kdf.iterations = get_u32(bytes.data() + 12);
+    header.kdf.memory_kib = get_u32(bytes.data() + 16);
+    header.kdf.lanes = get_u32(bytes.data() + 20);
+    if (!validate_kdf_params(header.kdf)) {
+        std::cerr << "Error: Unsupported key derivation parameters in header." << std::endl;
+        return false;
+    }
+
+    header.salt.assign(bytes.begin() + 24, bytes.begin() + 24 + SALT_SIZE);
+    header.nonce.assign(bytes.begin() + 24 + SALT_SIZE, bytes.begin() + 24 + SALT_SIZE + AEAD_NONCE_SIZE);
+    return true;
+}
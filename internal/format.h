@@ -0,0 +1,156 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+// On-disk layout of encrypted files.
+//
+// Legacy files (no magic):  [salt 16][IV 16][AES-256-CBC(data + "::END::")]
+// Current files:            [header][key slots][chunk 0][chunk 1]...[chunk N]
+//
+// Header (big-endian integers):
+//   magic "ENCR" (4) | version (1) | cipher suite (1) | KDF (1) | flags (1) |
+//   chunk size (4) | KDF iterations (4) | KDF memory KiB (4) | KDF lanes (4) |
+//   salt (16) | base nonce (12)
+//
+// Each chunk holds `chunk size` plaintext bytes (the final one may be shorter,
+// even empty) sealed with the AEAD suite, followed by its 16-byte tag. The
+// header is authenticated as additional data of every chunk.
+//
+// With HEADER_FLAG_KEY_SLOTS the chunks are sealed with a random data key and
+// KEY_SLOT_COUNT key slots of KEY_SLOT_SIZE bytes follow the header:
+//   state (1) | KDF (1) | reserved (2) | KDF iterations (4) | KDF memory KiB (4) |
+//   KDF lanes (4) | salt (16) | nonce (12) | wrapped data key (32) | tag (16) |
+//   reserved (4)
+// An active slot holds the data key sealed with AES-256-GCM under the key its
+// password derives; the header, the slot index and the slot bytes before the
+// wrapped key are its additional data. The slots are not part of the chunks'
+// additional data, so they can be rewritten in place. The salt and KDF fields
+// of the header are those of the slot written when the file was created.
+// Files without the flag derive the chunk key from the password directly.
+
+#include "internal/cipher.h"
+#include "internal/kdf.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+constexpr uint8_t FILE_MAGIC[4] = {'E', 'N', 'C', 'R'};
+constexpr uint8_t LEGACY_FORMAT_VERSION = 1;
+constexpr uint8_t FORMAT_VERSION = 2;
+constexpr std::size_t FILE_HEADER_SIZE = 52;
+constexpr std::size_t LEGACY_HEADER_SIZE = SALT_SIZE + IV_SIZE;
+constexpr uint32_t MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+
+// Header flags
+constexpr uint8_t HEADER_FLAG_RAW_PAYLOAD = 0x01;  // Payload is a raw byte stream, not a ZIP archive
+constexpr uint8_t HEADER_FLAG_KEY_SLOTS = 0x02;    // Chunks use a data key wrapped in key slots
+constexpr uint8_t HEADER_FLAG_CONTAINER = 0x04;    // Appendable container, see below
+constexpr uint8_t HEADER_KNOWN_FLAGS = HEADER_FLAG_RAW_PAYLOAD | HEADER_FLAG_KEY_SLOTS | HEADER_FLAG_CONTAINER;
+
+constexpr std::size_t KEY_SLOT_COUNT = 8;
+constexpr std::size_t KEY_SLOT_SIZE = 96;
+constexpr std::size_t KEY_SLOTS_SIZE = KEY_SLOT_COUNT * KEY_SLOT_SIZE;
+constexpr std::size_t KEY_SLOT_PARAMS_SIZE = 44;  // Slot bytes in front of the wrapped key
+
+// Multi-volume sets split the chunks of one encrypted stream across files:
+//   magic "ENCV" (4) | version (1) | reserved (3) | volume index (4) |
+//   volume count (4) | first chunk (8) | chunk count (8) | file header (52) |
+//   key slots (KEY_SLOTS_SIZE, with HEADER_FLAG_KEY_SLOTS)
+// followed by that volume's chunks, sealed exactly as in a single file. Each
+// volume carries the stream's file header, which identifies its set; chunk
+// nonces bind every chunk to its index, so misplaced volumes fail to decrypt.
+constexpr uint8_t VOLUME_MAGIC[4] = {'E', 'N', 'C', 'V'};
+constexpr std::size_t VOLUME_HEADER_SIZE = 32 + FILE_HEADER_SIZE;
+
+// Appendable containers (HEADER_FLAG_CONTAINER, always with key slots) hold
+// many files:
+//   [header][key slots][commit record A][commit record B][segments, indexes]
+// Each file is a segment sealed like a chunk stream under the data key with
+// its own random base nonce. The index lists the live entries and is sealed
+// the same way with CONTAINER_INDEX_AAD appended to the additional data.
+// Commit records are CONTAINER_RECORD_SIZE bytes:
+//   magic "ENCI" (4) | reserved (4) | generation (8) | index offset (8) |
+//   index size (8) | index nonce (12) | reserved (20)
+// The record with the highest generation whose index opens is current. An
+// append writes new segments and a new index after the current one, syncs,
+// and then overwrites the older record, so an interrupted append leaves the
+// previous state intact.
+constexpr uint8_t CONTAINER_RECORD_MAGIC[4] = {'E', 'N', 'C', 'I'};
+constexpr std::size_t CONTAINER_RECORD_SIZE = 64;
+constexpr std::size_t CONTAINER_DATA_OFFSET = FILE_HEADER_SIZE + KEY_SLOTS_SIZE + 2 * CONTAINER_RECORD_SIZE;
+constexpr char CONTAINER_INDEX_AAD[] = "index";
+
+struct VolumeHeader {
+    uint32_t index = 0;
+    uint32_t count = 0;
+    uint64_t first_chunk = 0;
+    uint64_t chunks = 0;
+    std::vector<uint8_t> file_header;  // FILE_HEADER_SIZE bytes
+    std::vector<uint8_t> key_slots;    // KEY_SLOTS_SIZE bytes, or empty without HEADER_FLAG_KEY_SLOTS
+};
+
+struct KeySlot {
+    bool active = false;
+    KdfParams kdf;
+    std::vector<uint8_t> salt;
+    std::vector<uint8_t> nonce;
+    std::vector<uint8_t> wrapped_key;  // Sealed data key followed by its tag
+};
+
+struct FileHeader {
+    uint8_t version = FORMAT_VERSION;
+    CipherSuite suite = CipherSuite::AES_256_GCM;
+    uint8_t flags = 0;
+    uint32_t chunk_size = STREAM_BUFFER_SIZE;
+    KdfParams kdf;
+    std::vector<uint8_t> salt;
+    std::vector<uint8_t> nonce;
+    std::vector<KeySlot> key_slots;  // KEY_SLOT_COUNT entries with HEADER_FLAG_KEY_SLOTS
+};
+
+bool has_file_magic(const uint8_t* data, std::size_t size);
+std::vector<uint8_t> serialize_header(const FileHeader& header);
+
+// Parses FILE_HEADER_SIZE bytes. Rejects unknown versions, suites and KDFs.
+bool parse_header(const std::vector<uint8_t>& bytes, FileHeader& header);
+
+// Serializes header.key_slots into KEY_SLOTS_SIZE bytes.
+std::vector<uint8_t> serialize_key_slots(const FileHeader& header);
+std::vector<uint8_t> serialize_key_slot(const KeySlot& slot);
+
+// Parses KEY_SLOTS_SIZE bytes into header.key_slots. Rejects unknown slot
+// states and invalid KDF parameters of active slots.
+bool parse_key_slots(const uint8_t* data, std::size_t size, FileHeader& header);
+
+// Offset of key slot `index` from the start of the file header.
+uint64_t key_slot_offset(std::size_t index);
+
+// Bytes in front of chunk 0 for a header with `flags`: the header itself and
+// its key slots, if any.
+std::size_t header_size(uint8_t flags);
+
+std::vector<uint8_t> serialize_volume_header(const VolumeHeader& header);
+
+// Checks magic, version and index ranges; the file header is not parsed.
+// `size` must cover the key slots if the file header announces them.
+bool parse_volume_header(const uint8_t* data, std::size_t size, VolumeHeader& header);
+
+// Size of a volume's header including the key slots, i.e. where its chunks start.
+std::size_t volume_header_size(const VolumeHeader& header);
+
+// Exact size of a new encrypted file (with key slots) holding `plain_size` bytes.
+uint64_t encrypted_size(uint64_t plain_size, uint32_t chunk_size);
+
+// File offset of chunk `index`; every chunk before it is full.
+uint64_t chunk_offset(const FileHeader& header, uint64_t index);
+
+// Splits the `payload_size` bytes after the header into chunks. Returns false
+// if they cannot be a complete chunk sequence (no room for a final tag).
+bool chunk_layout(uint64_t payload_size, uint32_t chunk_size, uint64_t& chunks, uint64_t& last_sealed);
+
+void put_u32(uint8_t* out, uint32_t value);
+uint32_t get_u32(const uint8_t* in);
+void put_u64(uint8_t* out, uint64_t value);
+uint64_t get_u64(const uint8_t* in);
+
+#endif // FORMAT_H
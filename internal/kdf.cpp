@@ -0,0 +1,236 @@
+#include "internal/kdf.h"
+
+#include "internal/encryption.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include <openssl/opensslv.h>
+
+#if OPENSSL_VERSION_NUMBER >= 0x30200000L
+#include <openssl/core_names.h>
+#include <openssl/kdf.h>
+#include <openssl/params.h>
+#include <openssl/thread.h>
+#define ENCRYPTOR_HAVE_ARGON2 1
+#endif
+
+namespace {
+
+#ifdef ENCRYPTOR_HAVE_ARGON2
+// One Argon2id derivation computing the lanes on `threads` threads. The key
+// does not depend on the thread count.
+bool argon2id_attempt(const std::string& password, const std::vector<uint8_t>& salt, const KdfParams& params,
+                      uint32_t threads, SecureBytes& key) {
+    EVP_KDF* kdf = EVP_KDF_fetch(nullptr, "ARGON2ID", nullptr);
+    if (!kdf) {
+        std::cerr << "Error: Argon2id is not available in this OpenSSL build." << std::endl;
+        return false;
+    }
+    EVP_KDF_CTX* kctx = EVP_KDF_CTX_new(kdf);
+    EVP_KDF_free(kdf);
+    if (!kctx) {
+        std::cerr << "Error: Failed to create Argon2id context." << std::endl;
+        return false;
+    }
+
+    uint32_t passes = params.iterations;
+    uint32_t memory = params.memory_kib;
+    uint32_t lanes = params.lanes;
+    OSSL_PARAM ossl_params[] = {
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_PASSWORD, const_cast<char*>(password.data()), password.size()),
+        OSSL_PARAM_construct_octet_string(OSSL_KDF_PARAM_SALT, const_cast<uint8_t*>(salt.data()), salt.size()),
+        OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_ITER, &passes),
+        OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_ARGON2_MEMCOST, &memory),
+        OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_ARGON2_LANES, &lanes),
+        OSSL_PARAM_construct_uint32(OSSL_KDF_PARAM_THREADS, &threads),
+        OSSL_PARAM_construct_end(),
+    };
+
+    int ok = EVP_KDF_derive(kctx, key.data(), key.size(), ossl_params);
+    EVP_KDF_CTX_free(kctx);
+    return ok == 1;
+}
+
+SecureBytes argon2id_derive(const std::string& password, const std::vector<uint8_t>& salt, const KdfParams& params,
+                            int keysize) {
+    // Lanes are only computed in parallel if the library has a thread pool.
+    // Without one, OpenSSL refuses any request for more than one thread.
+    static const bool threads_enabled = OSSL_set_max_threads(nullptr, MAX_ARGON2_LANES) == 1;
+    uint32_t threads = 1;
+    if (threads_enabled) {
+        threads = static_cast<uint32_t>(std::min<uint64_t>(params.lanes, OSSL_get_max_threads(nullptr)));
+        threads = std::max<uint32_t>(threads, 1);
+    }
+
+    SecureBytes key(keysize);
+    bool ok = argon2id_attempt(password, salt, params, threads, key);
+    if (!ok && threads > 1) {
+        // Concurrent derivations share the pool; when it is used up, compute
+        // the lanes on the calling thread alone
+        ok = argon2id_attempt(password, salt, params, 1, key);
+    }
+    if (!ok) {
+        std::cerr << "Error: Argon2id key derivation failed. "
+                  << "Passes: " << params.iterations << ", "
+                  << "Memory: " << params.memory_kib << " KiB, "
+                  << "Lanes: " << params.lanes << std::endl;
+        return {};
+    }
+    return key;
+}
+#endif
+
+} // namespace
+
+const char* kdf_name(KdfId id) {
+    switch (id) {
+        case KdfId::PBKDF2_SHA256: return "pbkdf2-sha256";
+        case KdfId::ARGON2ID: return "argon2id";
+    }
+    return "unknown";
+}
+
+bool parse_kdf_name(const std::string& name, KdfId& id) {
+    if (name == "pbkdf2" || name == "pbkdf2-sha256") {
+        id = KdfId::PBKDF2_SHA256;
+        return true;
+    }
+    if (name == "argon2id") {
+        id = KdfId::ARGON2ID;
+        return true;
+    }
+    return false;
+}
+
+KdfParams default_kdf_params(KdfId id) {
+    KdfParams params;
+    params.id = id;
+    if (id == KdfId::ARGON2ID) {
+        params.iterations = DEFAULT_ARGON2_PASSES;
+        params.memory_kib = DEFAULT_ARGON2_MEMORY_KIB;
+        params.lanes = DEFAULT_ARGON2_LANES;
+    }
+    return params;
+}
+
+bool argon2id_available() {
+#ifdef ENCRYPTOR_HAVE_ARGON2
+    static const bool available = [] {
+        EVP_KDF* kdf = EVP_KDF_fetch(nullptr, "ARGON2ID", nullptr);
+        EVP_KDF_free(kdf);
+        return kdf != nullptr;
+    }();
+    return available;
+#else
+    return false;
+#endif
+}
+
+bool validate_kdf_params(const KdfParams& params) {
+    switch (params.id) {
+        case KdfId::PBKDF2_SHA256:
+            return params.iterations > 0 && params.iterations <= static_cast<uint32_t>(std::numeric_limits<int>::max());
+        case KdfId::ARGON2ID:
+            // Argon2 requires at least 8 KiB of memory per lane.
+            return params.iterations > 0 && params.lanes > 0 && params.lanes <= MAX_ARGON2_LANES &&
+                   params.memory_kib >= 8 * params.lanes && params.memory_kib <= MAX_ARGON2_MEMORY_KIB;
+    }
+    return false;
+}
+
+SecureBytes derive_key(const std::string& password, const std::vector<uint8_t>& salt, const KdfParams& params,
+                       int keysize) {
+    if (!validate_kdf_params(params)) {
+        std::cerr << "Error: Invalid key derivation parameters." << std::endl;
+        return {};
+    }
+
+    switch (params.id) {
+        case KdfId::PBKDF2_SHA256:
+            return key_gene(password, salt, salt.size(), static_cast<int>(params.iterations), keysize);
+        case KdfId::ARGON2ID:
+#ifdef ENCRYPTOR_HAVE_ARGON2
+            return argon2id_derive(password, salt, params, keysize);
+#else
+            std::cerr << "Error: Argon2id requires OpenSSL 3.2 or newer." << std::endl;
+            return {};
+#endif
+    }
+    return {};
+}
+
+SecureBytes KeyCache::derive(const std::string& password, const std::vector<uint8_t>& salt, const KdfParams& params,
+                             int keysize) {
+    std::vector<uint8_t> id(salt);
+    const uint32_t fields[] = {static_cast<uint32_t>(params.id), params.iterations, params.memory_kib,
+                               params.lanes, static_cast<uint32_t>(keysize)};
+    for (uint32_t field : fields) {
+        for (int shift = 24; shift >= 0; shift -= 8) id.push_back(static_cast<uint8_t>(field >> shift));
+    }
+
+    // The first request for an id publishes a future and derives outside the
+    // lock; concurrent requests for the same id wait on that future instead
+    // of each running the KDF, and other ids are not held up
+    std::promise<SecureBytes> promise;
+    std::shared_future<SecureBytes> pending;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto found = keys_.find(id);
+        if (found != keys_.end()) {
+            pending = found->second;
+        } else {
+            keys_.emplace(id, promise.get_future().share());
+        }
+    }
+    if (pending.valid()) {
+        return pending.get();
+    }
+
+    SecureBytes key = derive_key(password, salt, params, keysize);
+    if (key.empty()) {
+        // Let a later request try again
+        std::lock_guard<std::mutex> lock(mutex_);
+        keys_.erase(id);
+    }
+    promise.set_value(key);
+    return key;
+}
+
+double measure_kdf_ms(const KdfParams& params) {
+    const std::string password = "calibration-password";
+    const std::vector<uint8_t> salt(SALT_SIZE, 0x42);
+
+    auto start = std::chrono::steady_clock::now();
+    SecureBytes key = derive_key(password, salt, params, KEY_SIZE);
+    std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+    if (key.empty()) return -1.0;
+    return elapsed.count();
+}
+
+KdfParams calibrate_kdf(const KdfParams& base, double target_ms) {
+    const bool pbkdf2 = base.id == KdfId::PBKDF2_SHA256;
+    const uint32_t floor = pbkdf2 ? MIN_PBKDF2_ITERATIONS : 1;
+
+    // Grow the probe until it runs long enough for the clock to be meaningful.
+    KdfParams probe = base;
+    probe.iterations = floor;
+    double ms = measure_kdf_ms(probe);
+    while (ms >= 0.0 && ms < 20.0 && probe.iterations < (1u << 30)) {
+        probe.iterations *= 2;
+        ms = measure_kdf_ms(probe);
+    }
+
+    KdfParams result = base;
+    if (ms <= 0.0) {
+        return result;
+    }
+
+    double per_iteration = ms / probe.iterations;
+    double wanted = std::floor(target_ms / per_iteration);
+    double ceiling = static_cast<double>(std::numeric_limits<int>::max());
+    result.iterations = static_cast<uint32_t>(std::max(static_cast<double>(floor), std::min(wanted, ceiling)));
+    return result;
+}
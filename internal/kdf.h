@@ -0,0 +1,82 @@
+#ifndef KDF_H
+#define KDF_H
+
+#include "internal/secure_memory.h"
+
+#include <cstdint>
+#include <future>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+// KDF IDs are stored in the file header, so existing values must never change.
+enum class KdfId : uint8_t {
+    PBKDF2_SHA256 = 1,
+    ARGON2ID = 2,   // Needs OpenSSL 3.2 or newer
+};
+
+constexpr uint32_t DEFAULT_PBKDF2_ITERATIONS = 100000;
+constexpr uint32_t MIN_PBKDF2_ITERATIONS = 10000;
+constexpr uint32_t DEFAULT_ARGON2_PASSES = 3;
+constexpr uint32_t DEFAULT_ARGON2_MEMORY_KIB = 64 * 1024;
+constexpr uint32_t DEFAULT_ARGON2_LANES = 4;
+constexpr uint32_t MAX_ARGON2_MEMORY_KIB = 4 * 1024 * 1024;
+constexpr uint32_t MAX_ARGON2_LANES = 64;
+
+// Legacy [salt][IV][CBC] files carry no parameters; they always used this.
+constexpr uint32_t LEGACY_PBKDF2_ITERATIONS = 100000;
+
+struct KdfParams {
+    KdfId id = KdfId::PBKDF2_SHA256;
+    uint32_t iterations = DEFAULT_PBKDF2_ITERATIONS;  // PBKDF2 iterations or Argon2 passes
+    uint32_t memory_kib = 0;                          // Argon2 only
+    uint32_t lanes = 0;                               // Argon2 only
+};
+
+const char* kdf_name(KdfId id);
+bool parse_kdf_name(const std::string& name, KdfId& id);
+
+// Default parameters for a KDF, before any calibration.
+KdfParams default_kdf_params(KdfId id);
+
+// True if this OpenSSL build can run Argon2id.
+bool argon2id_available();
+
+// Rejects unknown IDs and out-of-range values, e.g. from a corrupted header.
+bool validate_kdf_params(const KdfParams& params);
+
+// Derives `keysize` bytes from the password. Returns an empty vector on failure.
+SecureBytes derive_key(const std::string& password, const std::vector<uint8_t>& salt, const KdfParams& params,
+                       int keysize);
+
+// Remembers derived keys by salt and KDF parameters, so a batch of files
+// sharing them pays for the KDF once. Holds keys for one password only; use
+// a separate cache per password. Safe to share between threads: requests for
+// the same inputs wait for one derivation, while different salts or
+// parameters derive concurrently. Keys live in locked memory and are wiped on
+// destruction.
+class KeyCache {
+public:
+    KeyCache() = default;
+    KeyCache(const KeyCache&) = delete;
+    KeyCache& operator=(const KeyCache&) = delete;
+
+    // Like derive_key, but only derives on the first request for these inputs.
+    SecureBytes derive(const std::string& password, const std::vector<uint8_t>& salt, const KdfParams& params,
+                       int keysize);
+
+private:
+    std::mutex mutex_;
+    std::map<std::vector<uint8_t>, std::shared_future<SecureBytes>> keys_;
+};
+
+// Wall-clock time of a single derivation with `params`, in milliseconds.
+double measure_kdf_ms(const KdfParams& params);
+
+// Scales the iteration (PBKDF2) or pass (Argon2id) count of `base` so that one
+// derivation takes about `target_ms` on this host. Memory and lanes are kept
+// as given. Never goes below MIN_PBKDF2_ITERATIONS or one Argon2 pass.
+KdfParams calibrate_kdf(const KdfParams& base, double target_ms);
+
+#endif // KDF_H
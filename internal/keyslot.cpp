@@ -0,0 +1,215 @@
+#include "internal/keyslot.h"
+
+#include "internal/cipher.h"
+#include "internal/encryption.h"
+#include "internal/output.h"
+
+#include <cerrno>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// Binds a wrapped key to its file, its slot index and its KDF parameters.
+std::vector<uint8_t> slot_aad(const std::vector<uint8_t>& header_bytes, std::size_t index, const KeySlot& slot) {
+    std::vector<uint8_t> aad(header_bytes);
+    aad.push_back(static_cast<uint8_t>(index));
+    std::vector<uint8_t> bytes = serialize_key_slot(slot);
+    aad.insert(aad.end(), bytes.begin(), bytes.begin() + KEY_SLOT_PARAMS_SIZE);
+    return aad;
+}
+
+SecureBytes slot_key(const std::string& password, const KeySlot& slot, KeyCache* keys) {
+    return keys ? keys->derive(password, slot.salt, slot.kdf, KEY_SIZE)
+                : derive_key(password, slot.salt, slot.kdf, KEY_SIZE);
+}
+
+// Fills slot `index` of `header` with `data_key` wrapped under `password`.
+// The slot's KDF parameters and salt must already be set.
+bool seal_key_slot(FileHeader& header, std::size_t index, const SecureBytes& data_key,
+                   const std::string& password, KeyCache* keys) {
+    KeySlot& slot = header.key_slots[index];
+    slot.active = true;
+    slot.nonce = generated_salt_and_IV(AEAD_NONCE_SIZE);
+    SecureBytes kek = slot_key(password, slot, keys);
+    if (slot.nonce.empty() || kek.empty()) {
+        std::cerr << "Error: Failed to derive key" << std::endl;
+        secure_clear(kek);
+        return false;
+    }
+
+    ChunkCipher cipher;
+    slot.wrapped_key.assign(KEY_SIZE + AEAD_TAG_SIZE, 0);
+    bool ok = cipher.init(*find_cipher_suite(CipherSuite::AES_256_GCM), kek, slot.nonce,
+                          slot_aad(serialize_header(header), index, slot), true) &&
+              cipher.seal(0, true, data_key.data(), data_key.size(), slot.wrapped_key.data());
+    secure_clear(kek);
+    if (!ok) {
+        std::cerr << "Error: Failed to seal key slot " << index << std::endl;
+    }
+    return ok;
+}
+
+// Returns the data key from the first slot `password` opens, and its index.
+SecureBytes open_key_slot(const FileHeader& header, const std::string& password, KeyCache* keys,
+                          std::size_t& opened) {
+    const std::vector<uint8_t> header_bytes = serialize_header(header);
+    for (std::size_t index = 0; index < header.key_slots.size(); ++index) {
+        const KeySlot& slot = header.key_slots[index];
+        if (!slot.active) continue;
+
+        SecureBytes kek = slot_key(password, slot, keys);
+        if (kek.empty()) continue;
+        ChunkCipher cipher;
+        SecureBytes data_key(KEY_SIZE);
+        bool ok = cipher.init(*find_cipher_suite(CipherSuite::AES_256_GCM), kek, slot.nonce,
+                              slot_aad(header_bytes, index, slot), false) &&
+                  cipher.open(0, true, slot.wrapped_key.data(), slot.wrapped_key.size(), data_key.data());
+        secure_clear(kek);
+        if (ok) {
+            opened = index;
+            return data_key;
+        }
+        secure_clear(data_key);
+    }
+    return {};
+}
+
+// Writes one slot to every file and makes it durable before returning.
+bool write_key_slot(const std::vector<FileDescriptor>& fds, const std::vector<std::string>& paths,
+                    uint64_t header_offset, std::size_t index, const KeySlot& slot) {
+    std::vector<uint8_t> bytes = serialize_key_slot(slot);
+    for (std::size_t i = 0; i < fds.size(); ++i) {
+        if (!pwrite_full(fds[i].get(), bytes.data(), bytes.size(), header_offset + key_slot_offset(index)) ||
+            ::fdatasync(fds[i].get()) != 0) {
+            std::cerr << "Error: Failed to write key slot to " << paths[i] << " (" << std::strerror(errno) << ")"
+                      << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+SecureBytes new_data_key(FileHeader& header, const std::string& password, KeyCache* keys) {
+    SecureBytes data_key = generated_key(KEY_SIZE);
+    if (data_key.empty()) {
+        return {};
+    }
+    header.key_slots.assign(KEY_SLOT_COUNT, KeySlot());
+    header.key_slots[0].kdf = header.kdf;
+    header.key_slots[0].salt = header.salt;
+    if (!seal_key_slot(header, 0, data_key, password, keys)) {
+        secure_clear(data_key);
+        return {};
+    }
+    return data_key;
+}
+
+SecureBytes unlock_file_key(const FileHeader& header, const std::string& password, KeyCache* keys) {
+    if (!(header.flags & HEADER_FLAG_KEY_SLOTS)) {
+        SecureBytes key = keys ? keys->derive(password, header.salt, header.kdf, KEY_SIZE)
+                               : derive_key(password, header.salt, header.kdf, KEY_SIZE);
+        if (key.empty()) {
+            std::cerr << "Error: Key derivation failed." << std::endl;
+        }
+        return key;
+    }
+
+    std::size_t opened = 0;
+    SecureBytes data_key = open_key_slot(header, password, keys, opened);
+    if (data_key.empty()) {
+        std::cerr << "Error: No key slot opens with this password." << std::endl;
+    }
+    return data_key;
+}
+
+bool change_key_slots(const std::vector<std::string>& paths, uint64_t header_offset, const std::string& password,
+                      const KeySlotUpdate& update) {
+    if (paths.empty()) {
+        return false;
+    }
+
+    // Every file must carry the same header; the slots of the first are used
+    std::vector<FileDescriptor> fds;
+    std::vector<uint8_t> header_bytes;
+    for (const std::string& path : paths) {
+        fds.emplace_back(::open(path.c_str(), O_RDWR | O_CLOEXEC));
+        std::vector<uint8_t> bytes(FILE_HEADER_SIZE);
+        if (fds.back().get() < 0 || !pread_full(fds.back().get(), bytes.data(), bytes.size(), header_offset)) {
+            std::cerr << "Error: Failed to read encrypted file: " << path << std::endl;
+            return false;
+        }
+        if (header_bytes.empty()) {
+            header_bytes = bytes;
+        } else if (bytes != header_bytes) {
+            std::cerr << "Error: " << path << " does not belong to the same file." << std::endl;
+            return false;
+        }
+    }
+
+    FileHeader header;
+    if (!parse_header(header_bytes, header)) {
+        return false;
+    }
+    if (!(header.flags & HEADER_FLAG_KEY_SLOTS)) {
+        std::cerr << "Error: " << paths[0] << " has no key slots; its password can only be changed by "
+                  << "decrypting and encrypting it again." << std::endl;
+        return false;
+    }
+    std::vector<uint8_t> slots(KEY_SLOTS_SIZE);
+    if (!pread_full(fds[0].get(), slots.data(), slots.size(), header_offset + FILE_HEADER_SIZE) ||
+        !parse_key_slots(slots.data(), slots.size(), header)) {
+        std::cerr << "Error: Invalid key slots in " << paths[0] << std::endl;
+        return false;
+    }
+
+    std::size_t opened = 0;
+    SecureBytes data_key = open_key_slot(header, password, nullptr, opened);
+    if (data_key.empty()) {
+        std::cerr << "Error: No key slot opens with this password." << std::endl;
+        return false;
+    }
+
+    if (update.change != KeySlotChange::REMOVE) {
+        std::size_t free_slot = 0;
+        while (free_slot < KEY_SLOT_COUNT && header.key_slots[free_slot].active) ++free_slot;
+        if (free_slot == KEY_SLOT_COUNT) {
+            std::cerr << "Error: All " << KEY_SLOT_COUNT << " key slots are in use; remove one first." << std::endl;
+            secure_clear(data_key);
+            return false;
+        }
+
+        header.key_slots[free_slot].kdf = update.kdf;
+        header.key_slots[free_slot].salt = generated_salt_and_IV(SALT_SIZE);
+        bool sealed = !header.key_slots[free_slot].salt.empty() &&
+                      seal_key_slot(header, free_slot, data_key, update.new_password, nullptr);
+        secure_clear(data_key);
+        if (!sealed || !write_key_slot(fds, paths, header_offset, free_slot, header.key_slots[free_slot])) {
+            return false;
+        }
+        std::cout << "Key slot " << free_slot << " added" << std::endl;
+    }
+    secure_clear(data_key);
+
+    if (update.change != KeySlotChange::ADD) {
+        std::size_t active = 0;
+        for (const KeySlot& slot : header.key_slots) active += slot.active ? 1 : 0;
+        if (active < 2) {
+            std::cerr << "Error: Refusing to remove the only key slot." << std::endl;
+            return false;
+        }
+        if (!write_key_slot(fds, paths, header_offset, opened, KeySlot())) {
+            return false;
+        }
+        std::cout << "Key slot " << opened << " removed" << std::endl;
+    }
+    return true;
+}
+
+bool rekey_file(const std::string& path, const std::string& password, const KeySlotUpdate& update) {
+    return change_key_slots({path}, 0, password, update);
+}
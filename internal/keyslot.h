@@ -0,0 +1,51 @@
+#ifndef KEYSLOT_H
+#define KEYSLOT_H
+
+// Envelope encryption (layout in internal/format.h).
+//
+// New files seal their chunks with a random data key. Each active key slot
+// holds that key wrapped under the key one password derives, so changing,
+// adding or removing a password rewrites a single slot in place, whatever the
+// size of the file.
+
+#include "internal/format.h"
+#include "internal/kdf.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class KeySlotChange {
+    REPLACE,  // Swap the password that opens a slot for a new one
+    ADD,      // Add a slot for another password, keeping the current ones
+    REMOVE,   // Clear the slot the password opens; the last slot cannot go
+};
+
+struct KeySlotUpdate {
+    KeySlotChange change = KeySlotChange::REPLACE;
+    std::string new_password;  // REPLACE and ADD only
+    KdfParams kdf;             // Parameters of the new slot
+};
+
+// Generates the data key of a new file and seals it into slot 0 of `header`
+// under `password`, with the header salt and KDF parameters. With `keys`,
+// the password-derived key is taken from / stored in that cache. Returns the
+// data key, or an empty vector on failure.
+SecureBytes new_data_key(FileHeader& header, const std::string& password, KeyCache* keys = nullptr);
+
+// Returns the key the chunks of `header` are sealed with: the data key from
+// the first slot `password` opens, or the password-derived key for files
+// without key slots. Prints an error and returns an empty vector on failure.
+SecureBytes unlock_file_key(const FileHeader& header, const std::string& password, KeyCache* keys = nullptr);
+
+// Applies `update` to the key slots of the file header found at
+// `header_offset` in each of `paths`: a single file, or every volume of a set.
+// `password` must open one of the slots. New slots are written and synced
+// before old ones are cleared, so an interruption leaves a working password.
+bool change_key_slots(const std::vector<std::string>& paths, uint64_t header_offset, const std::string& password,
+                      const KeySlotUpdate& update);
+
+// change_key_slots for a single encrypted file.
+bool rekey_file(const std::string& path, const std::string& password, const KeySlotUpdate& update);
+
+#endif // KEYSLOT_H
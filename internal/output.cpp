@@ -0,0 +1,404 @@
+#include "internal/output.h"
+
+#include "internal/encryption.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int MAX_NAME_CANDIDATES = 10000;
+
+std::atomic<FsyncPolicy> g_default_policy{FsyncPolicy::BATCHED};
+
+std::string candidate_name(const std::string& target, int count) {
+    return count == 0 ? target : target + "_" + std::to_string(count);
+}
+
+std::string directory_of(const std::string& path) {
+    std::string dir = std::filesystem::path(path).parent_path().string();
+    return dir.empty() ? "." : dir;
+}
+
+std::string hidden_temp_base(const std::string& target) {
+    std::filesystem::path path(target);
+    return (std::filesystem::path(directory_of(target)) / ("." + path.filename().string())).string();
+}
+
+bool fsync_directory(const std::string& dir) {
+    int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) return false;
+    bool ok = ::fsync(fd) == 0;
+    ::close(fd);
+    return ok;
+}
+
+// Remembers one directory per filesystem and syncs each filesystem once per
+// batch, which is far cheaper than an fsync per file under parallel load.
+class FsyncBatch {
+public:
+    ~FsyncBatch() { flush(); }
+
+    void add(const std::string& dir) {
+        struct stat st;
+        if (::stat(dir.c_str(), &st) != 0) return;
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        bool known = false;
+        for (const auto& entry : filesystems_) {
+            if (entry.first == st.st_dev) known = true;
+        }
+        if (!known) filesystems_.emplace_back(st.st_dev, dir);
+        if (++pending_ >= FSYNC_BATCH_FILES) flush_locked();
+    }
+
+    void flush() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        flush_locked();
+    }
+
+private:
+    void flush_locked() {
+        for (const auto& entry : filesystems_) {
+            int fd = ::open(entry.second.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if (fd < 0) continue;
+            if (::syncfs(fd) != 0) {
+                std::cerr << "Warning: Failed to sync filesystem of: " << entry.second << std::endl;
+            }
+            ::close(fd);
+        }
+        filesystems_.clear();
+        pending_ = 0;
+    }
+
+    std::mutex mutex_;
+    std::vector<std::pair<dev_t, std::string>> filesystems_;
+    std::size_t pending_ = 0;
+};
+
+FsyncBatch& fsync_batch() {
+    static FsyncBatch batch;
+    return batch;
+}
+
+} // namespace
+
+bool parse_fsync_policy(const std::string& name, FsyncPolicy& policy) {
+    if (name == "none") {
+        policy = FsyncPolicy::NONE;
+    } else if (name == "file") {
+        policy = FsyncPolicy::PER_FILE;
+    } else if (name == "batch") {
+        policy = FsyncPolicy::BATCHED;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+FsyncPolicy default_fsync_policy() {
+    return g_default_policy.load();
+}
+
+void set_default_fsync_policy(FsyncPolicy policy) {
+    g_default_policy.store(policy);
+}
+
+void flush_fsync_batch() {
+    fsync_batch().flush();
+}
+
+std::string publish_unique(const std::string& source, const std::string& target) {
+    for (int count = 0; count < MAX_NAME_CANDIDATES; ++count) {
+        std::string candidate = candidate_name(target, count);
+        if (::renameat2(AT_FDCWD, source.c_str(), AT_FDCWD, candidate.c_str(), RENAME_NOREPLACE) == 0) {
+            return candidate;
+        }
+        if (errno == EEXIST) continue;
+        if (errno != EINVAL && errno != ENOSYS) break;
+
+        // No RENAME_NOREPLACE on this filesystem: link() is exclusive as well
+        if (::link(source.c_str(), candidate.c_str()) == 0) {
+            ::unlink(source.c_str());
+            return candidate;
+        }
+        if (errno != EEXIST) break;
+    }
+    std::cerr << "Error: Could not publish file: " << target << " (" << std::strerror(errno) << ")" << std::endl;
+    return "";
+}
+
+bool pread_full(int fd, uint8_t* data, std::size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+bool pwrite_full(int fd, const uint8_t* data, std::size_t size, uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+FileDescriptor::~FileDescriptor() {
+    if (fd_ >= 0) ::close(fd_);
+}
+
+FdStreamBuf::FdStreamBuf() : buffer_(STREAM_BUFFER_SIZE) {
+    char* begin = reinterpret_cast<char*>(buffer_.data());
+    setp(begin, begin + buffer_.size());
+}
+
+void FdStreamBuf::attach(int fd) {
+    fd_ = fd;
+    failed_ = false;
+    position_ = 0;
+    end_ = 0;
+    setp(pbase(), epptr());
+}
+
+bool FdStreamBuf::write_all(const char* data, std::size_t size) {
+    while (size > 0 && !failed_) {
+        ssize_t n = ::write(fd_, data, size);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            failed_ = true;
+            break;
+        }
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        position_ += static_cast<uint64_t>(n);
+    }
+    end_ = std::max(end_, position_);
+    return !failed_;
+}
+
+bool FdStreamBuf::flush_buffer() {
+    std::size_t pending = static_cast<std::size_t>(pptr() - pbase());
+    bool ok = pending == 0 || write_all(pbase(), pending);
+    setp(pbase(), epptr());
+    return ok && !failed_;
+}
+
+FdStreamBuf::int_type FdStreamBuf::overflow(int_type ch) {
+    if (!flush_buffer()) return traits_type::eof();
+    if (!traits_type::eq_int_type(ch, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(ch);
+        pbump(1);
+    }
+    return traits_type::not_eof(ch);
+}
+
+std::streamsize FdStreamBuf::xsputn(const char* data, std::streamsize size) {
+    // Large writes skip the buffer entirely
+    if (size >= static_cast<std::streamsize>(buffer_.size())) {
+        if (!flush_buffer() || !write_all(data, static_cast<std::size_t>(size))) return 0;
+        return size;
+    }
+
+    std::streamsize done = 0;
+    while (done < size) {
+        std::streamsize room = epptr() - pptr();
+        if (room == 0) {
+            if (!flush_buffer()) return done;
+            continue;
+        }
+        std::streamsize n = std::min(room, size - done);
+        std::memcpy(pptr(), data + done, static_cast<std::size_t>(n));
+        pbump(static_cast<int>(n));
+        done += n;
+    }
+    return done;
+}
+
+int FdStreamBuf::sync() {
+    return flush_buffer() ? 0 : -1;
+}
+
+FdStreamBuf::pos_type FdStreamBuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+    if (!(which & std::ios_base::out) || !flush_buffer()) return pos_type(off_type(-1));
+
+    off_type base = dir == std::ios_base::beg ? 0
+                  : dir == std::ios_base::cur ? static_cast<off_type>(position_)
+                                              : static_cast<off_type>(end_);
+    off_type target = base + off;
+    if (target < 0) return pos_type(off_type(-1));
+    if (target != static_cast<off_type>(position_) && ::lseek(fd_, target, SEEK_SET) < 0) {
+        failed_ = true;
+        return pos_type(off_type(-1));
+    }
+    position_ = static_cast<uint64_t>(target);
+    return pos_type(target);
+}
+
+FdStreamBuf::pos_type FdStreamBuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+    return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+bool FdStreamBuf::truncate(uint64_t size) {
+    if (!flush_buffer() || ::ftruncate(fd_, static_cast<off_t>(size)) != 0) {
+        failed_ = true;
+        return false;
+    }
+    end_ = size;
+    return true;
+}
+
+AtomicFileWriter::AtomicFileWriter() : stream_(&buf_) {}
+
+AtomicFileWriter::~AtomicFileWriter() {
+    abort();
+}
+
+bool AtomicFileWriter::open(const std::string& target, uint64_t expected_size, FsyncPolicy policy) {
+    abort();
+    target_ = target;
+    policy_ = policy;
+    std::string dir = directory_of(target);
+
+#ifdef O_TMPFILE
+    fd_ = ::open(dir.c_str(), O_TMPFILE | O_WRONLY | O_CLOEXEC, 0666);
+#endif
+    if (fd_ < 0) {
+        // Filesystem without O_TMPFILE: use a hidden, exclusively created name
+        for (int attempt = 0; attempt < 16 && fd_ < 0; ++attempt) {
+            temp_path_ = make_temp_path(hidden_temp_base(target));
+            fd_ = ::open(temp_path_.c_str(), O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC, 0666);
+            if (fd_ < 0 && errno != EEXIST) break;
+        }
+        if (fd_ < 0) {
+            std::cerr << "Error: Failed to create file: " << target << " (" << std::strerror(errno) << ")" << std::endl;
+            temp_path_.clear();
+            return false;
+        }
+    }
+
+    // Best effort: not every filesystem supports preallocation. KEEP_SIZE
+    // reserves the blocks without moving EOF, so read_path() never shows a
+    // zero tail when the guess is larger than what gets written
+    if (expected_size > 0 &&
+        ::fallocate(fd_, FALLOC_FL_KEEP_SIZE, 0, static_cast<off_t>(expected_size)) == 0) {
+        preallocated_ = expected_size;
+    }
+
+    buf_.attach(fd_);
+    stream_.clear();
+    return true;
+}
+
+bool AtomicFileWriter::resize(uint64_t size) {
+    if (fd_ < 0) return false;
+    stream_.flush();
+    return buf_.truncate(size);
+}
+
+std::string AtomicFileWriter::read_path() const {
+    if (!temp_path_.empty()) return temp_path_;
+    return "/proc/self/fd/" + std::to_string(fd_);
+}
+
+std::string AtomicFileWriter::commit(PublishMode mode) {
+    if (fd_ < 0) return "";
+
+    stream_.flush();
+    if (!buf_.flush_buffer() || !stream_) {
+        std::cerr << "Error: Failed to write file: " << target_ << std::endl;
+        abort();
+        return "";
+    }
+    if (preallocated_ > buf_.size() && ::ftruncate(fd_, static_cast<off_t>(buf_.size())) != 0) {
+        std::cerr << "Error: Failed to trim file: " << target_ << std::endl;
+        abort();
+        return "";
+    }
+    if (policy_ == FsyncPolicy::PER_FILE && ::fsync(fd_) != 0) {
+        std::cerr << "Error: Failed to sync file: " << target_ << std::endl;
+        abort();
+        return "";
+    }
+
+    std::string published;
+    if (temp_path_.empty()) {
+        // Give the anonymous inode a name; linkat fails rather than overwrite
+        std::string proc_path = read_path();
+        if (mode == PublishMode::UNIQUE_NAME) {
+            for (int count = 0; count < MAX_NAME_CANDIDATES; ++count) {
+                std::string candidate = candidate_name(target_, count);
+                if (::linkat(AT_FDCWD, proc_path.c_str(), AT_FDCWD, candidate.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+                    published = candidate;
+                    break;
+                }
+                if (errno != EEXIST) break;
+            }
+        } else {
+            std::string staging = make_temp_path(hidden_temp_base(target_));
+            if (::linkat(AT_FDCWD, proc_path.c_str(), AT_FDCWD, staging.c_str(), AT_SYMLINK_FOLLOW) == 0) {
+                if (::rename(staging.c_str(), target_.c_str()) == 0) {
+                    published = target_;
+                } else {
+                    ::unlink(staging.c_str());
+                }
+            }
+        }
+    } else if (mode == PublishMode::UNIQUE_NAME) {
+        published = publish_unique(temp_path_, target_);
+        if (!published.empty()) temp_path_.clear();
+    } else if (::rename(temp_path_.c_str(), target_.c_str()) == 0) {
+        published = target_;
+        temp_path_.clear();
+    }
+
+    if (published.empty()) {
+        std::cerr << "Error: Could not publish file: " << target_ << " (" << std::strerror(errno) << ")" << std::endl;
+        abort();
+        return "";
+    }
+
+    buf_.attach(-1);
+    ::close(fd_);
+    fd_ = -1;
+    preallocated_ = 0;
+
+    if (policy_ == FsyncPolicy::PER_FILE) {
+        fsync_directory(directory_of(published));
+    } else if (policy_ == FsyncPolicy::BATCHED) {
+        fsync_batch().add(directory_of(published));
+    }
+    return published;
+}
+
+void AtomicFileWriter::abort() {
+    buf_.attach(-1);
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+    if (!temp_path_.empty()) {
+        ::unlink(temp_path_.c_str());
+        temp_path_.clear();
+    }
+    preallocated_ = 0;
+}
@@ -0,0 +1,146 @@
+#ifndef OUTPUT_H
+#define OUTPUT_H
+
+// Crash-safe output files.
+//
+// AtomicFileWriter writes into an anonymous O_TMPFILE inode (or a hidden
+// temporary name on filesystems without O_TMPFILE) in the target directory,
+// preallocates the expected size with fallocate, and only makes the file
+// visible under its final name on commit. Readers never see a half-written
+// file, an interrupted run leaves nothing behind, and concurrent jobs
+// picking the same name each get a distinct one because publishing fails
+// atomically on collision (linkat / renameat2 with RENAME_NOREPLACE) instead
+// of probing with exists().
+
+#include "internal/pool.h"
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+enum class FsyncPolicy {
+    NONE,      // Leave durability to the kernel
+    PER_FILE,  // fsync the file before publishing and its directory afterwards
+    BATCHED,   // Sync each filesystem once per batch of published files, and at exit
+};
+
+enum class PublishMode {
+    UNIQUE_NAME,  // Use the target name, or the first free target_N
+    REPLACE,      // Atomically replace an existing target
+};
+
+bool parse_fsync_policy(const std::string& name, FsyncPolicy& policy);
+
+// Policy used by writers that do not pick one. Defaults to BATCHED.
+FsyncPolicy default_fsync_policy();
+void set_default_fsync_policy(FsyncPolicy policy);
+
+// Syncs every filesystem that received BATCHED files since the last flush.
+// Runs automatically every FSYNC_BATCH_FILES files and at process exit.
+constexpr std::size_t FSYNC_BATCH_FILES = 64;
+void flush_fsync_batch();
+
+// Renames `source` to `target`, or to the first free `target_N`, without ever
+// replacing an existing file. Returns the name used, or "" on failure.
+std::string publish_unique(const std::string& source, const std::string& target);
+
+// Positional I/O on raw descriptors, retrying EINTR and short transfers.
+// pread_full fails at end of file.
+bool pread_full(int fd, uint8_t* data, std::size_t size, uint64_t offset);
+bool pwrite_full(int fd, const uint8_t* data, std::size_t size, uint64_t offset);
+
+// Owns a raw descriptor and closes it on destruction.
+class FileDescriptor {
+public:
+    explicit FileDescriptor(int fd) : fd_(fd) {}
+    ~FileDescriptor();
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+    FileDescriptor(FileDescriptor&& other) noexcept : fd_(other.fd_) { other.fd_ = -1; }
+
+    int get() const { return fd_; }
+
+private:
+    int fd_;
+};
+
+class FdStreamBuf : public std::streambuf {
+public:
+    FdStreamBuf();
+    void attach(int fd);
+    bool flush_buffer();
+    bool failed() const { return failed_; }
+
+    // Highest offset written so far, i.e. the logical file size
+    uint64_t size() const { return end_; }
+
+    // Sets the file size; growing it leaves a hole
+    bool truncate(uint64_t size);
+
+protected:
+    int_type overflow(int_type ch) override;
+    std::streamsize xsputn(const char* data, std::streamsize size) override;
+    int sync() override;
+    pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+    pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+private:
+    bool write_all(const char* data, std::size_t size);
+
+    int fd_ = -1;
+    bool failed_ = false;
+    uint64_t position_ = 0;
+    uint64_t end_ = 0;
+    PooledBuffer buffer_;
+};
+
+class AtomicFileWriter {
+public:
+    AtomicFileWriter();
+    ~AtomicFileWriter();
+    AtomicFileWriter(const AtomicFileWriter&) = delete;
+    AtomicFileWriter& operator=(const AtomicFileWriter&) = delete;
+
+    // Prepares an unpublished file for `target`. `expected_size` (0 if
+    // unknown) is preallocated to keep large outputs contiguous.
+    bool open(const std::string& target, uint64_t expected_size = 0,
+              FsyncPolicy policy = default_fsync_policy());
+
+    // Sequential writes go through stream(); seekp() skips ahead, leaving a
+    // hole for sparse outputs.
+    std::ostream& stream() { return stream_; }
+
+    // Sets the final file size, e.g. to end a sparse file with a hole.
+    bool resize(uint64_t size);
+
+    // Descriptor for positional writes (pwrite_full) from several threads.
+    // Call resize() with the final size before commit(), which otherwise
+    // trims the file to what went through stream().
+    int fd() const { return fd_; }
+
+    // A path the unpublished contents can be read back from, e.g. to hand
+    // them to a library that only accepts file names. Flush stream() first;
+    // the file holds exactly the bytes written so far, with no preallocated
+    // tail.
+    std::string read_path() const;
+
+    // Flushes, trims any unused preallocation, syncs per policy and publishes
+    // the file. Returns the final path, or "" on failure (nothing is published).
+    std::string commit(PublishMode mode = PublishMode::UNIQUE_NAME);
+
+    // Discards the unpublished file.
+    void abort();
+
+private:
+    std::string target_;
+    std::string temp_path_;  // Empty when using O_TMPFILE
+    int fd_ = -1;
+    uint64_t preallocated_ = 0;
+    FsyncPolicy policy_ = FsyncPolicy::BATCHED;
+    FdStreamBuf buf_;
+    std::ostream stream_;
+};
+
+#endif // OUTPUT_H
@@ -0,0 +1,85 @@
+#include "internal/pool.h"
+
+#include <openssl/crypto.h>
+
+namespace {
+
+constexpr int MIN_SIZE_CLASS = 12;          // 4 KiB
+constexpr int MAX_SIZE_CLASS = 22;          // 4 MiB; larger chunks are rare and would pin too much locked memory
+constexpr std::size_t MAX_POOLED_PER_CLASS = 4;
+constexpr std::size_t MAX_POOLED_CONTEXTS = 16;
+
+struct ThreadPools {
+    std::vector<std::unique_ptr<EVPContext>> contexts;
+    std::vector<SecureBytes> buffers[MAX_SIZE_CLASS + 1];
+};
+
+ThreadPools& thread_pools() {
+    thread_local ThreadPools pools;
+    return pools;
+}
+
+int size_class(std::size_t size) {
+    int cls = MIN_SIZE_CLASS;
+    while (cls <= MAX_SIZE_CLASS && (static_cast<std::size_t>(1) << cls) < size) {
+        ++cls;
+    }
+    return cls;
+}
+
+} // namespace
+
+PooledCipherContext::PooledCipherContext() {
+    ThreadPools& pools = thread_pools();
+    if (!pools.contexts.empty()) {
+        ctx_ = std::move(pools.contexts.back());
+        pools.contexts.pop_back();
+        return;
+    }
+    ctx_ = std::make_unique<EVPContext>();
+}
+
+PooledCipherContext::~PooledCipherContext() {
+    if (!valid()) return;
+    ThreadPools& pools = thread_pools();
+    if (pools.contexts.size() >= MAX_POOLED_CONTEXTS || EVP_CIPHER_CTX_reset(ctx_->get()) != 1) {
+        return;
+    }
+    pools.contexts.push_back(std::move(ctx_));
+}
+
+PooledBuffer::PooledBuffer(std::size_t size) : size_(size) {
+    int cls = size_class(size);
+    if (cls > MAX_SIZE_CLASS) {
+        storage_.resize(size);
+        return;
+    }
+
+    ThreadPools& pools = thread_pools();
+    auto& free_list = pools.buffers[cls];
+    if (!free_list.empty()) {
+        storage_ = std::move(free_list.back());
+        free_list.pop_back();
+        return;
+    }
+    storage_.resize(static_cast<std::size_t>(1) << cls);
+}
+
+PooledBuffer::~PooledBuffer() {
+    if (storage_.empty()) return;
+    OPENSSL_cleanse(storage_.data(), size_);
+
+    int cls = size_class(storage_.size());
+    if (cls > MAX_SIZE_CLASS || storage_.size() != (static_cast<std::size_t>(1) << cls)) {
+        return;
+    }
+    auto& free_list = thread_pools().buffers[cls];
+    if (free_list.size() < MAX_POOLED_PER_CLASS) {
+        free_list.push_back(std::move(storage_));
+    }
+}
+
+void PooledBuffer::swap(PooledBuffer& other) noexcept {
+    storage_.swap(other.storage_);
+    std::swap(size_, other.size_);
+}
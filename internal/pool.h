@@ -0,0 +1,58 @@
+#ifndef POOL_H
+#define POOL_H
+
+// Thread-local recycling of cipher contexts and I/O buffers.
+//
+// Acquiring takes an object from the calling thread's pool, or creates one
+// when the pool is empty; destruction hands it back. Once a thread has
+// processed its first file, later files of similar size reuse the same
+// contexts and buffers instead of going through malloc and
+// EVP_CIPHER_CTX_new again.
+
+#include "internal/encryption.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// A cipher context borrowed from the thread's pool. It is handed out in the
+// reset state and must be initialized (cipher + key) before use; on release
+// it is reset with EVP_CIPHER_CTX_reset, which also wipes the key schedule.
+class PooledCipherContext {
+public:
+    PooledCipherContext();
+    ~PooledCipherContext();
+    PooledCipherContext(const PooledCipherContext&) = delete;
+    PooledCipherContext& operator=(const PooledCipherContext&) = delete;
+
+    EVP_CIPHER_CTX* get() { return ctx_ ? ctx_->get() : nullptr; }
+    bool valid() const { return ctx_ && ctx_->valid(); }
+
+private:
+    std::unique_ptr<EVPContext> ctx_;
+};
+
+// A byte buffer of at least `size` bytes, backed by locked storage (see
+// internal/secure_memory.h) rounded up to a power-of-two size class. Contents
+// are wiped before the storage is pooled, since buffers carry plaintext and
+// key-dependent data. Buffers above 4 MiB are not pooled; they go straight
+// back to the arena when released.
+class PooledBuffer {
+public:
+    explicit PooledBuffer(std::size_t size);
+    ~PooledBuffer();
+    PooledBuffer(const PooledBuffer&) = delete;
+    PooledBuffer& operator=(const PooledBuffer&) = delete;
+
+    uint8_t* data() { return storage_.data(); }
+    const uint8_t* data() const { return storage_.data(); }
+    std::size_t size() const { return size_; }
+    void swap(PooledBuffer& other) noexcept;
+
+private:
+    SecureBytes storage_;
+    std::size_t size_;
+};
+
+#endif // POOL_H
@@ -0,0 +1,459 @@
+#include "internal/resume.h"
+
+#include "internal/cipher.h"
+#include "internal/encryption.h"
+#include "internal/format.h"
+#include "internal/keyslot.h"
+#include "internal/output.h"
+#include "internal/pool.h"
+#include "internal/zip.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <openssl/evp.h>
+
+namespace {
+
+// Journal layout (big-endian): magic "ENCJ" (4) | version (1) | operation (1) |
+// reserved (2) | source size (8) | source mtime ns (8) | chunks done (8) |
+// file header (52) | SHA-256 of all preceding bytes (32)
+const uint8_t JOURNAL_MAGIC[4] = {'E', 'N', 'C', 'J'};
+constexpr uint8_t JOURNAL_VERSION = 1;
+constexpr std::size_t JOURNAL_BODY_SIZE = 32 + FILE_HEADER_SIZE;
+constexpr std::size_t JOURNAL_DIGEST_SIZE = 32;
+constexpr std::size_t JOURNAL_SIZE = JOURNAL_BODY_SIZE + JOURNAL_DIGEST_SIZE;
+
+enum class JournalOp : uint8_t {
+    ENCRYPT = 1,
+    DECRYPT = 2,
+};
+
+struct Journal {
+    JournalOp operation = JournalOp::ENCRYPT;
+    uint64_t source_size = 0;
+    uint64_t source_mtime = 0;
+    uint64_t chunks_done = 0;
+    std::vector<uint8_t> header;
+};
+
+bool journal_digest(const uint8_t* data, uint8_t* digest) {
+    unsigned int size = 0;
+    return EVP_Digest(data, JOURNAL_BODY_SIZE, digest, &size, EVP_sha256(), nullptr) == 1 &&
+           size == JOURNAL_DIGEST_SIZE;
+}
+
+// Replaces the journal atomically, syncing it and its directory.
+bool write_journal(const std::string& path, const Journal& journal) {
+    std::vector<uint8_t> bytes(JOURNAL_SIZE, 0);
+    std::memcpy(bytes.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+    bytes[4] = JOURNAL_VERSION;
+    bytes[5] = static_cast<uint8_t>(journal.operation);
+    put_u64(bytes.data() + 8, journal.source_size);
+    put_u64(bytes.data() + 16, journal.source_mtime);
+    put_u64(bytes.data() + 24, journal.chunks_done);
+    std::copy(journal.header.begin(), journal.header.end(), bytes.begin() + 32);
+    if (!journal_digest(bytes.data(), bytes.data() + JOURNAL_BODY_SIZE)) {
+        return false;
+    }
+
+    AtomicFileWriter out;
+    if (!out.open(path, JOURNAL_SIZE, FsyncPolicy::PER_FILE)) {
+        return false;
+    }
+    out.stream().write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    if (!out.stream() || out.commit(PublishMode::REPLACE).empty()) {
+        std::cerr << "Error: Could not write journal: " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool read_journal(const std::string& path, Journal& journal) {
+    std::ifstream in(path, std::ios::binary);
+    std::vector<uint8_t> bytes(JOURNAL_SIZE);
+    if (!in.read(reinterpret_cast<char*>(bytes.data()), bytes.size()) || in.peek() != EOF) {
+        return false;
+    }
+
+    uint8_t digest[JOURNAL_DIGEST_SIZE];
+    if (std::memcmp(bytes.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0 || bytes[4] != JOURNAL_VERSION ||
+        !journal_digest(bytes.data(), digest) ||
+        std::memcmp(digest, bytes.data() + JOURNAL_BODY_SIZE, JOURNAL_DIGEST_SIZE) != 0) {
+        return false;
+    }
+
+    journal.operation = static_cast<JournalOp>(bytes[5]);
+    journal.source_size = get_u64(bytes.data() + 8);
+    journal.source_mtime = get_u64(bytes.data() + 16);
+    journal.chunks_done = get_u64(bytes.data() + 24);
+    journal.header.assign(bytes.begin() + 32, bytes.begin() + JOURNAL_BODY_SIZE);
+    return true;
+}
+
+// Size and modification time tie a journal to the source it was written for.
+void source_identity(const struct stat& st, uint64_t& size, uint64_t& mtime) {
+    size = static_cast<uint64_t>(st.st_size);
+    mtime = static_cast<uint64_t>(st.st_mtim.tv_sec) * 1000000000ull + static_cast<uint64_t>(st.st_mtim.tv_nsec);
+}
+
+bool source_identity(const std::string& path, uint64_t& size, uint64_t& mtime) {
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0) return false;
+    source_identity(st, size, mtime);
+    return true;
+}
+
+bool sync_path(const std::string& path) {
+    FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    return fd.get() >= 0 && ::fsync(fd.get()) == 0;
+}
+
+void remove_quietly(const std::string& path) {
+    std::error_code ec;
+    fs::remove(path, ec);
+}
+
+uint64_t journal_interval(uint32_t chunk_size) {
+    return std::max<uint64_t>(1, RESUME_JOURNAL_INTERVAL / chunk_size);
+}
+
+} // namespace
+
+std::string encrypt_path_resumable(const std::string& input, const std::string& output_file,
+                                   const std::string& password, const EncryptOptions& options) {
+    const std::string part = output_file + ".part";
+    const std::string journal_path = part + ".journal";
+    const std::string archive = output_file + ".zip.part";
+
+    Journal journal;
+    FileHeader header;
+    uint64_t archive_size = 0;
+    uint64_t archive_mtime = 0;
+    bool resuming = read_journal(journal_path, journal) && journal.operation == JournalOp::ENCRYPT &&
+                    parse_header(journal.header, header) && fs::exists(part) &&
+                    source_identity(archive, archive_size, archive_mtime) &&
+                    archive_size == journal.source_size && archive_mtime == journal.source_mtime;
+
+    if (!resuming) {
+        remove_quietly(part);
+        remove_quietly(journal_path);
+        remove_quietly(archive);
+        if (!archive_path(input, archive) || !sync_path(archive) ||
+            !source_identity(archive, archive_size, archive_mtime)) {
+            std::cerr << "Error: Failed to create zip file" << std::endl;
+            remove_quietly(archive);
+            return "";
+        }
+        if (!new_file_header(options, header)) {
+            remove_quietly(archive);
+            return "";
+        }
+        journal = Journal();
+        journal.operation = JournalOp::ENCRYPT;
+        journal.source_size = archive_size;
+        journal.source_mtime = archive_mtime;
+        journal.header = serialize_header(header);
+    }
+
+    const uint32_t chunk_size = header.chunk_size;
+    const uint64_t chunks = archive_size == 0 ? 1 : (archive_size + chunk_size - 1) / chunk_size;
+    if (journal.chunks_done > chunks) {
+        std::cerr << "Error: Journal does not match the archive: " << journal_path << std::endl;
+        return "";
+    }
+    auto plain_length = [&](uint64_t index) {
+        return static_cast<std::size_t>(std::min<uint64_t>(chunk_size, archive_size - index * chunk_size));
+    };
+
+    FileDescriptor in(::open(archive.c_str(), O_RDONLY | O_CLOEXEC));
+    FileDescriptor out(::open(part.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+    if (in.get() < 0 || out.get() < 0) {
+        std::cerr << "Error: Could not open partial output: " << part << " (" << std::strerror(errno) << ")"
+                  << std::endl;
+        return "";
+    }
+
+    // A fresh run seals a new data key; a resumed one unlocks the key slots
+    // already written to the partial output
+    SecureBytes key;
+    if (!resuming) {
+        key = new_data_key(header, password);
+    } else if (header.flags & HEADER_FLAG_KEY_SLOTS) {
+        std::vector<uint8_t> key_slots(KEY_SLOTS_SIZE);
+        if (!pread_full(out.get(), key_slots.data(), key_slots.size(), FILE_HEADER_SIZE) ||
+            !parse_key_slots(key_slots.data(), key_slots.size(), header)) {
+            std::cerr << "Error: Partial output has no valid key slots. Delete " << part << " to start over."
+                      << std::endl;
+            return "";
+        }
+        key = unlock_file_key(header, password);
+    } else {
+        key = unlock_file_key(header, password);
+    }
+    if (key.empty()) {
+        return "";
+    }
+    ChunkCipher cipher;
+    bool init_ok = cipher.init(*find_cipher_suite(header.suite), key, header.nonce, journal.header, true);
+    secure_clear(key);
+    if (!init_ok) {
+        return "";
+    }
+
+    PooledBuffer plain(chunk_size);
+    PooledBuffer sealed(chunk_size + AEAD_TAG_SIZE);
+    PooledBuffer on_disk(std::max<std::size_t>(chunk_size + AEAD_TAG_SIZE, FILE_HEADER_SIZE));
+    std::vector<uint8_t> prefix = journal.header;
+    if (header.flags & HEADER_FLAG_KEY_SLOTS) {
+        std::vector<uint8_t> key_slots = serialize_key_slots(header);
+        prefix.insert(prefix.end(), key_slots.begin(), key_slots.end());
+    }
+
+    if (resuming && journal.chunks_done > 0) {
+        // Sealing is deterministic, so the last journaled chunk must come out
+        // byte for byte as it is on disk; otherwise the password differs
+        uint64_t last = journal.chunks_done - 1;
+        std::size_t length = plain_length(last);
+        bool match = pread_full(out.get(), on_disk.data(), FILE_HEADER_SIZE, 0) &&
+                     std::equal(journal.header.begin(), journal.header.end(), on_disk.data()) &&
+                     pread_full(in.get(), plain.data(), length, last * chunk_size) &&
+                     cipher.seal(last, last + 1 == chunks, plain.data(), length, sealed.data()) &&
+                     pread_full(out.get(), on_disk.data(), length + AEAD_TAG_SIZE, chunk_offset(header, last)) &&
+                     std::memcmp(on_disk.data(), sealed.data(), length + AEAD_TAG_SIZE) == 0;
+        if (!match) {
+            std::cerr << "Error: Partial output does not match its journal (wrong password?). "
+                      << "Delete " << part << " to start over." << std::endl;
+            return "";
+        }
+        std::cout << "Resuming encryption at chunk " << journal.chunks_done << " of " << chunks << std::endl;
+    } else if (!pwrite_full(out.get(), prefix.data(), prefix.size(), 0) ||
+               ::fdatasync(out.get()) != 0 || !write_journal(journal_path, journal)) {
+        std::cerr << "Error: Failed to start partial output: " << part << std::endl;
+        return "";
+    }
+
+    // Anything past the last journaled chunk may be torn
+    if (::ftruncate(out.get(), static_cast<off_t>(chunk_offset(header, journal.chunks_done))) != 0) {
+        std::cerr << "Error: Failed to truncate partial output: " << part << std::endl;
+        return "";
+    }
+
+    const uint64_t interval = journal_interval(chunk_size);
+    for (uint64_t index = journal.chunks_done; index < chunks; ++index) {
+        std::size_t length = plain_length(index);
+        bool final = index + 1 == chunks;
+        if (!pread_full(in.get(), plain.data(), length, index * chunk_size) ||
+            !cipher.seal(index, final, plain.data(), length, sealed.data()) ||
+            !pwrite_full(out.get(), sealed.data(), length + AEAD_TAG_SIZE, chunk_offset(header, index))) {
+            std::cerr << "Error: Encryption failed at chunk " << index << std::endl;
+            return "";
+        }
+
+        if (!final && (index + 1) % interval == 0) {
+            journal.chunks_done = index + 1;
+            if (::fdatasync(out.get()) != 0 || !write_journal(journal_path, journal)) {
+                return "";
+            }
+        }
+    }
+
+    if (::fdatasync(out.get()) != 0) {
+        std::cerr << "Error: Failed to sync encrypted output: " << part << std::endl;
+        return "";
+    }
+
+    remove_quietly(journal_path);
+    std::string published = publish_unique(part, output_file);
+    if (!published.empty()) {
+        remove_quietly(archive);
+    }
+    return published;
+}
+
+bool decrypt_path_resumable(const std::string& input, const std::string& output_folder, const std::string& password) {
+    FileDescriptor in(::open(input.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (in.get() < 0 || ::fstat(in.get(), &st) != 0) {
+        std::cerr << "Error: Failed to read encrypted file: " << input << std::endl;
+        return false;
+    }
+
+    std::vector<uint8_t> header_bytes(FILE_HEADER_SIZE);
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+    if (file_size < FILE_HEADER_SIZE || !pread_full(in.get(), header_bytes.data(), FILE_HEADER_SIZE, 0) ||
+        !has_file_magic(header_bytes.data(), header_bytes.size())) {
+        std::cout << "Legacy files cannot be resumed; decrypting in one go." << std::endl;
+        return decrypt_path(input, output_folder, password);
+    }
+
+    FileHeader header;
+    uint64_t chunks = 0;
+    uint64_t last_sealed = 0;
+    if (!parse_header(header_bytes, header)) {
+        std::cerr << "Error: Invalid file header." << std::endl;
+        return false;
+    }
+    const std::size_t prefix = header_size(header.flags);
+    if (prefix > FILE_HEADER_SIZE) {
+        std::vector<uint8_t> key_slots(KEY_SLOTS_SIZE);
+        if (file_size < prefix || !pread_full(in.get(), key_slots.data(), key_slots.size(), FILE_HEADER_SIZE) ||
+            !parse_key_slots(key_slots.data(), key_slots.size(), header)) {
+            std::cerr << "Error: Invalid key slots." << std::endl;
+            return false;
+        }
+    }
+    if (!chunk_layout(file_size - prefix, header.chunk_size, chunks, last_sealed)) {
+        std::cerr << "Error: Encrypted data is truncated." << std::endl;
+        return false;
+    }
+
+    fs::path name = fs::path(input).filename();
+    if (name.extension() == ".enc") name.replace_extension();
+    try {
+        fs::create_directories(output_folder);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error: Could not create output directory: " << e.what() << std::endl;
+        return false;
+    }
+    const std::string target = (fs::path(output_folder) / name).string();
+    const std::string part = target + ".part";
+    const std::string journal_path = part + ".journal";
+
+    uint64_t source_size = 0;
+    uint64_t source_mtime = 0;
+    source_identity(st, source_size, source_mtime);
+
+    Journal journal;
+    bool resuming = read_journal(journal_path, journal) && journal.operation == JournalOp::DECRYPT &&
+                    journal.source_size == source_size && journal.source_mtime == source_mtime &&
+                    journal.header == header_bytes && journal.chunks_done <= chunks && fs::exists(part);
+    if (!resuming) {
+        journal = Journal();
+        journal.operation = JournalOp::DECRYPT;
+        journal.source_size = source_size;
+        journal.source_mtime = source_mtime;
+        journal.header = header_bytes;
+    }
+
+    FileDescriptor out(::open(part.c_str(), O_RDWR | O_CREAT | O_CLOEXEC | (resuming ? 0 : O_TRUNC), 0644));
+    if (out.get() < 0) {
+        std::cerr << "Error: Could not open partial output: " << part << " (" << std::strerror(errno) << ")"
+                  << std::endl;
+        return false;
+    }
+
+    SecureBytes key = unlock_file_key(header, password);
+    if (key.empty()) {
+        return false;
+    }
+    ChunkCipher cipher;
+    bool init_ok = cipher.init(*find_cipher_suite(header.suite), key, header.nonce, header_bytes, false);
+    secure_clear(key);
+    if (!init_ok) {
+        return false;
+    }
+
+    const uint32_t chunk_size = header.chunk_size;
+    auto sealed_length = [&](uint64_t index) {
+        return static_cast<std::size_t>(index + 1 == chunks ? last_sealed : chunk_size + AEAD_TAG_SIZE);
+    };
+    // Plaintext bytes the first `done` chunks decrypt to; the last may be short
+    auto plain_end = [&](uint64_t done) {
+        return done > 0 && done == chunks ? (done - 1) * chunk_size + last_sealed - AEAD_TAG_SIZE
+                                          : done * chunk_size;
+    };
+    PooledBuffer sealed(chunk_size + AEAD_TAG_SIZE);
+    PooledBuffer plain(chunk_size);
+    PooledBuffer on_disk(chunk_size);
+
+    if (resuming && journal.chunks_done > 0) {
+        // The last journaled chunk must decrypt to what the partial file holds
+        uint64_t last = journal.chunks_done - 1;
+        std::size_t length = sealed_length(last);
+        std::size_t plain_length = length - AEAD_TAG_SIZE;
+        bool match = pread_full(in.get(), sealed.data(), length, chunk_offset(header, last)) &&
+                     cipher.open(last, last + 1 == chunks, sealed.data(), length, plain.data()) &&
+                     pread_full(out.get(), on_disk.data(), plain_length, last * chunk_size) &&
+                     std::memcmp(on_disk.data(), plain.data(), plain_length) == 0;
+        if (!match) {
+            std::cerr << "Error: Partial output does not match its journal (wrong password?). "
+                      << "Delete " << part << " to start over." << std::endl;
+            return false;
+        }
+        if (journal.chunks_done == chunks) {
+            std::cout << "Decryption already complete; extracting" << std::endl;
+        } else {
+            std::cout << "Resuming decryption at chunk " << journal.chunks_done << " of " << chunks << std::endl;
+        }
+    } else if (!write_journal(journal_path, journal)) {
+        return false;
+    }
+
+    if (::ftruncate(out.get(), static_cast<off_t>(plain_end(journal.chunks_done))) != 0) {
+        std::cerr << "Error: Failed to truncate partial output: " << part << std::endl;
+        return false;
+    }
+
+    const uint64_t interval = journal_interval(chunk_size);
+    for (uint64_t index = journal.chunks_done; index < chunks; ++index) {
+        std::size_t length = sealed_length(index);
+        bool final = index + 1 == chunks;
+        if (!pread_full(in.get(), sealed.data(), length, chunk_offset(header, index))) {
+            std::cerr << "Error: Failed to read encrypted input" << std::endl;
+            return false;
+        }
+        if (!cipher.open(index, final, sealed.data(), length, plain.data())) {
+            std::cerr << "Error: Authentication failed at chunk " << index << std::endl;
+            return false;
+        }
+        if (!pwrite_full(out.get(), plain.data(), length - AEAD_TAG_SIZE, index * chunk_size)) {
+            std::cerr << "Error: Failed to write decrypted output" << std::endl;
+            return false;
+        }
+
+        if (!final && (index + 1) % interval == 0) {
+            journal.chunks_done = index + 1;
+            if (::fdatasync(out.get()) != 0 || !write_journal(journal_path, journal)) {
+                return false;
+            }
+        }
+    }
+
+    if (::fdatasync(out.get()) != 0) {
+        std::cerr << "Error: Failed to sync decrypted output: " << part << std::endl;
+        return false;
+    }
+
+    if (header.flags & HEADER_FLAG_RAW_PAYLOAD) {
+        remove_quietly(journal_path);
+        std::string published = publish_unique(part, target);
+        if (published.empty()) {
+            return false;
+        }
+        std::cout << "Raw payload written: " << published << std::endl;
+        return true;
+    }
+
+    // Journal the whole file before extracting: the journal stays until
+    // extraction succeeds, so a rerun only extracts
+    if (journal.chunks_done != chunks) {
+        journal.chunks_done = chunks;
+        if (!write_journal(journal_path, journal)) {
+            return false;
+        }
+    }
+    if (!unzip_file(part, output_folder, true)) {
+        std::cerr << "Error: Failed to extract files" << std::endl;
+        return false;
+    }
+    remove_quietly(journal_path);
+    remove_quietly(part);
+    return true;
+}
@@ -0,0 +1,37 @@
+#ifndef RESUME_H
+#define RESUME_H
+
+// Resumable encryption and decryption for very large inputs.
+//
+// Work goes to named partial files next to the final output. Every
+// RESUME_JOURNAL_INTERVAL bytes the partial file is synced and a sidecar
+// journal records how many chunks it holds. Chunk nonces derive from the base
+// nonce in the header and the chunk index, so the header, the key slots at
+// the start of the partial file and a chunk count are all the cipher state
+// there is. Rerunning with the same arguments checks the
+// journal against its source and the last journaled chunk against the partial
+// output, then continues after that chunk.
+//
+//   encrypt: <output>.zip.part (archive), <output>.part, <output>.part.journal
+//   decrypt: <folder>/<name>.part, <folder>/<name>.part.journal
+//
+// Building the ZIP archive is a single step; an interruption there restarts
+// the archive, but not once encryption has begun.
+
+#include "internal/encryptor.h"
+
+#include <cstdint>
+#include <string>
+
+constexpr uint64_t RESUME_JOURNAL_INTERVAL = 256ull * 1024 * 1024;
+
+// Like encrypt_path, resuming an interrupted run for the same output if its
+// journal is still valid.
+std::string encrypt_path_resumable(const std::string& input, const std::string& output_file,
+                                   const std::string& password, const EncryptOptions& options = EncryptOptions());
+
+// Like decrypt_path, resuming an interrupted run for the same input if its
+// journal is still valid. Legacy files are decrypted in one go.
+bool decrypt_path_resumable(const std::string& input, const std::string& output_folder, const std::string& password);
+
+#endif // RESUME_H
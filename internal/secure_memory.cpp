@@ -0,0 +1,170 @@
+#include "internal/secure_memory.h"
+
+#include <openssl/crypto.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <mutex>
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace {
+
+constexpr int MIN_SIZE_CLASS = 5;                            // 32 B
+constexpr int MAX_SIZE_CLASS = 20;                           // 1 MiB, larger blocks get their own mapping
+constexpr std::size_t SLAB_SIZE = static_cast<std::size_t>(2) << 20;  // Carved into blocks of up to 1 MiB
+
+int size_class(std::size_t size) {
+    int cls = MIN_SIZE_CLASS;
+    while (cls <= MAX_SIZE_CLASS && (static_cast<std::size_t>(1) << cls) < size) {
+        ++cls;
+    }
+    return cls;
+}
+
+std::size_t page_rounded(std::size_t size) {
+    static const std::size_t page = static_cast<std::size_t>(::sysconf(_SC_PAGESIZE));
+    return (size + page - 1) / page * page;
+}
+
+// Blocks up to 1 MiB are carved from locked slabs and recycled through
+// per-class free lists; slabs are never unmapped. Larger blocks are mapped
+// and unmapped one by one. Every released block is wiped first, so blocks
+// are always handed out zeroed.
+class SecureArena {
+public:
+    void* allocate(std::size_t size) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        int cls = size_class(size);
+        if (cls > MAX_SIZE_CLASS) {
+            std::size_t bytes = page_rounded(size);
+            bool locked = false;
+            void* block = map_pages(bytes, locked);
+            if (!block) throw std::bad_alloc();
+            large_[block] = locked;
+            stats_.in_use_bytes += bytes;
+            return block;
+        }
+
+        const std::size_t bytes = static_cast<std::size_t>(1) << cls;
+        std::vector<void*>& free_list = free_[cls];
+        if (!free_list.empty()) {
+            void* block = free_list.back();
+            free_list.pop_back();
+            stats_.in_use_bytes += bytes;
+            return block;
+        }
+
+        if (slab_left_ < bytes) {
+            bool locked = false;
+            void* slab = map_pages(SLAB_SIZE, locked);
+            if (!slab) throw std::bad_alloc();
+            recycle_slab_tail();
+            slab_ = static_cast<uint8_t*>(slab);
+            slab_left_ = SLAB_SIZE;
+        }
+        void* block = slab_;
+        slab_ += bytes;
+        slab_left_ -= bytes;
+        stats_.in_use_bytes += bytes;
+        return block;
+    }
+
+    void deallocate(void* block, std::size_t size) noexcept {
+        if (!block) return;
+        OPENSSL_cleanse(block, size);
+
+        std::lock_guard<std::mutex> lock(mutex_);
+        int cls = size_class(size);
+        if (cls > MAX_SIZE_CLASS) {
+            std::size_t bytes = page_rounded(size);
+            auto found = large_.find(block);
+            if (found != large_.end()) {
+                (found->second ? stats_.locked_bytes : stats_.unlocked_bytes) -= bytes;
+                large_.erase(found);
+            }
+            ::munmap(block, bytes);
+            stats_.in_use_bytes -= bytes;
+            return;
+        }
+
+        stats_.in_use_bytes -= static_cast<std::size_t>(1) << cls;
+        try {
+            free_[cls].push_back(block);
+        } catch (const std::bad_alloc&) {
+            // The block is wiped; losing track of it only leaks arena space
+        }
+    }
+
+    SecureMemoryStats stats() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        return stats_;
+    }
+
+private:
+    void* map_pages(std::size_t bytes, bool& locked) {
+        void* pages = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (pages == MAP_FAILED) {
+            return nullptr;
+        }
+#ifdef MADV_DONTDUMP
+        ::madvise(pages, bytes, MADV_DONTDUMP);
+#endif
+        locked = ::mlock(pages, bytes) == 0;
+        if (locked) {
+            stats_.locked_bytes += bytes;
+        } else {
+            stats_.unlocked_bytes += bytes;
+            if (!warned_) {
+                warned_ = true;
+                std::cerr << "Warning: Could not lock memory for keys and plaintext (" << std::strerror(errno)
+                          << "); raise the memlock limit (ulimit -l) to keep it out of swap." << std::endl;
+            }
+        }
+        return pages;
+    }
+
+    // Hands the unused end of the current slab to the free lists.
+    void recycle_slab_tail() {
+        for (int cls = MAX_SIZE_CLASS; cls >= MIN_SIZE_CLASS; --cls) {
+            const std::size_t bytes = static_cast<std::size_t>(1) << cls;
+            while (slab_left_ >= bytes) {
+                free_[cls].push_back(slab_);
+                slab_ += bytes;
+                slab_left_ -= bytes;
+            }
+        }
+    }
+
+    std::mutex mutex_;
+    std::vector<void*> free_[MAX_SIZE_CLASS + 1];
+    std::map<void*, bool> large_;  // Mapping -> whether it is locked
+    uint8_t* slab_ = nullptr;
+    std::size_t slab_left_ = 0;
+    SecureMemoryStats stats_;
+    bool warned_ = false;
+};
+
+// Never destroyed: thread-local pools and static objects may still release
+// blocks while the process exits.
+SecureArena& arena() {
+    static SecureArena* instance = new SecureArena();
+    return *instance;
+}
+
+} // namespace
+
+SecureMemoryStats secure_memory_stats() {
+    return arena().stats();
+}
+
+void* secure_allocate(std::size_t size) {
+    return arena().allocate(size);
+}
+
+void secure_deallocate(void* block, std::size_t size) noexcept {
+    arena().deallocate(block, size);
+}
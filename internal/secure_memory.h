@@ -0,0 +1,58 @@
+#ifndef SECURE_MEMORY_H
+#define SECURE_MEMORY_H
+
+// Locked, zeroizing memory for keys and plaintext.
+//
+// Blocks come from a process-wide arena of pages that are mlock'ed, so they
+// never reach swap, and excluded from core dumps. A released block is wiped
+// with OPENSSL_cleanse, which the compiler cannot drop, and kept on a free
+// list for its size class, so steady-state processing neither calls malloc
+// nor leaves key material behind. Once RLIMIT_MEMLOCK is used up, further
+// pages are still wiped but no longer locked; a warning is printed once.
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+struct SecureMemoryStats {
+    std::size_t locked_bytes = 0;    // Arena pages held in RAM
+    std::size_t unlocked_bytes = 0;  // Arena pages mlock refused
+    std::size_t in_use_bytes = 0;    // Handed out and not yet released
+};
+
+SecureMemoryStats secure_memory_stats();
+
+// Returns at least `size` bytes of zeroed arena memory. Throws std::bad_alloc
+// if no pages can be mapped.
+void* secure_allocate(std::size_t size);
+
+// Wipes and releases a block from secure_allocate, given its requested size.
+void secure_deallocate(void* block, std::size_t size) noexcept;
+
+// Standard allocator over the arena, for containers holding secrets.
+template <typename T>
+struct SecureAllocator {
+    using value_type = T;
+
+    SecureAllocator() noexcept = default;
+    template <typename U>
+    SecureAllocator(const SecureAllocator<U>&) noexcept {}
+
+    T* allocate(std::size_t n) {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T)) throw std::bad_alloc();
+        return static_cast<T*>(secure_allocate(n * sizeof(T)));
+    }
+    void deallocate(T* p, std::size_t n) noexcept { secure_deallocate(p, n * sizeof(T)); }
+
+    template <typename U>
+    bool operator==(const SecureAllocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const SecureAllocator<U>&) const noexcept { return false; }
+};
+
+// Key material and plaintext. Releasing the storage wipes it, so dropping a
+// SecureBytes is enough; secure_clear also works for an early release.
+using SecureBytes = std::vector<uint8_t, SecureAllocator<uint8_t>>;
+
+#endif // SECURE_MEMORY_H
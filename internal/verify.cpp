@@ -0,0 +1,392 @@
+#include "internal/verify.h"
+
+#include "internal/cipher.h"
+#include "internal/encryption.h"
+#include "internal/encryptor.h"
+#include "internal/kdf.h"
+#include "internal/keyslot.h"
+#include "internal/output.h"
+#include "internal/pool.h"
+#include "internal/zip.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <streambuf>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Chunk layout of an encrypted file opened for random access.
+struct SealedFile {
+    int fd = -1;
+    FileHeader header;
+    std::vector<uint8_t> header_bytes;
+    SecureBytes key;
+    uint64_t chunks = 0;
+    uint64_t last_sealed = 0;  // Size of the final chunk including its tag
+    uint64_t plain_size = 0;
+
+    SealedFile() = default;
+    SealedFile(const SealedFile&) = delete;
+    SealedFile& operator=(const SealedFile&) = delete;
+    ~SealedFile() {
+        secure_clear(key);
+        if (fd >= 0) ::close(fd);
+    }
+
+    std::size_t sealed_size(uint64_t index) const {
+        return index + 1 == chunks ? last_sealed : header.chunk_size + AEAD_TAG_SIZE;
+    }
+
+    bool init_cipher(ChunkCipher& cipher) const {
+        return cipher.init(*find_cipher_suite(header.suite), key, header.nonce, header_bytes, false);
+    }
+
+    // Reads and authenticates chunk `index`, writing its plaintext to `plain`.
+    bool open_chunk(ChunkCipher& cipher, uint64_t index, PooledBuffer& sealed, uint8_t* plain) const {
+        std::size_t size = sealed_size(index);
+        return pread_full(fd, sealed.data(), size, chunk_offset(header, index)) &&
+               cipher.open(index, index + 1 == chunks, sealed.data(), size, plain);
+    }
+};
+
+// Runs `work` on `count` threads, the calling one included.
+template <typename Work>
+void run_workers(unsigned count, Work work) {
+    std::vector<std::thread> workers;
+    for (unsigned i = 1; i < count; i++) {
+        workers.emplace_back(work);
+    }
+    work();
+    for (std::thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// Returns the index of the first chunk failing authentication, or file.chunks.
+uint64_t authenticate_chunks(const SealedFile& file, unsigned threads) {
+    std::atomic<uint64_t> next{0};
+    std::atomic<uint64_t> first_bad{file.chunks};
+
+    auto fail = [&](uint64_t index) {
+        uint64_t current = first_bad.load();
+        while (index < current && !first_bad.compare_exchange_weak(current, index)) {
+        }
+    };
+
+    run_workers(threads, [&]() {
+        ChunkCipher cipher;
+        if (!file.init_cipher(cipher)) {
+            fail(0);
+            return;
+        }
+        PooledBuffer sealed(file.header.chunk_size + AEAD_TAG_SIZE);
+        PooledBuffer plain(file.header.chunk_size);
+        // Chunks past a known failure need not be checked
+        for (uint64_t index = next++; index < first_bad.load(); index = next++) {
+            if (!file.open_chunk(cipher, index, sealed, plain.data())) {
+                fail(index);
+            }
+        }
+    });
+    return first_bad.load();
+}
+
+// Seekable read-only zip source over the decrypted payload. The chunk being
+// read is cached, so sequential reads decrypt each chunk once.
+struct PayloadSource {
+    explicit PayloadSource(const SealedFile& sealed_file)
+        : file(sealed_file),
+          sealed(sealed_file.header.chunk_size + AEAD_TAG_SIZE),
+          plain(sealed_file.header.chunk_size) {
+        zip_error_init(&error);
+    }
+    ~PayloadSource() { zip_error_fini(&error); }
+
+    const SealedFile& file;
+    ChunkCipher cipher;
+    PooledBuffer sealed;
+    PooledBuffer plain;
+    uint64_t cached = UINT64_MAX;
+    uint64_t position = 0;
+    zip_error_t error;
+};
+
+zip_int64_t payload_source_callback(void* userdata, void* data, zip_uint64_t length, zip_source_cmd_t command) {
+    PayloadSource* source = static_cast<PayloadSource*>(userdata);
+    const SealedFile& file = source->file;
+
+    switch (command) {
+    case ZIP_SOURCE_OPEN:
+        source->position = 0;
+        return 0;
+
+    case ZIP_SOURCE_READ: {
+        uint8_t* out = static_cast<uint8_t*>(data);
+        zip_uint64_t produced = 0;
+        while (produced < length && source->position < file.plain_size) {
+            uint64_t index = source->position / file.header.chunk_size;
+            if (index != source->cached) {
+                source->cached = UINT64_MAX;
+                if (!file.open_chunk(source->cipher, index, source->sealed, source->plain.data())) {
+                    zip_error_set(&source->error, ZIP_ER_READ, EBADMSG);
+                    return -1;
+                }
+                source->cached = index;
+            }
+            uint64_t offset = source->position - index * file.header.chunk_size;
+            uint64_t available = file.sealed_size(index) - AEAD_TAG_SIZE - offset;
+            std::size_t n = static_cast<std::size_t>(std::min<uint64_t>(length - produced, available));
+            std::memcpy(out + produced, source->plain.data() + offset, n);
+            produced += n;
+            source->position += n;
+        }
+        return static_cast<zip_int64_t>(produced);
+    }
+
+    case ZIP_SOURCE_CLOSE:
+        return 0;
+
+    case ZIP_SOURCE_STAT: {
+        zip_stat_t* st = static_cast<zip_stat_t*>(data);
+        zip_stat_init(st);
+        st->size = file.plain_size;
+        st->valid |= ZIP_STAT_SIZE;
+        return sizeof(*st);
+    }
+
+    case ZIP_SOURCE_ERROR:
+        return zip_error_to_data(&source->error, data, length);
+
+    case ZIP_SOURCE_FREE:
+        delete source;
+        return 0;
+
+    case ZIP_SOURCE_SEEK: {
+        zip_int64_t position = zip_source_seek_compute_offset(source->position, file.plain_size, data, length,
+                                                              &source->error);
+        if (position < 0) return -1;
+        source->position = static_cast<uint64_t>(position);
+        return 0;
+    }
+
+    case ZIP_SOURCE_TELL:
+        return static_cast<zip_int64_t>(source->position);
+
+    case ZIP_SOURCE_SUPPORTS:
+        return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE, ZIP_SOURCE_STAT,
+                                              ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, ZIP_SOURCE_SEEK, ZIP_SOURCE_TELL,
+                                              ZIP_SOURCE_SUPPORTS, -1);
+
+    default:
+        zip_error_set(&source->error, ZIP_ER_INTERNAL, 0);
+        return -1;
+    }
+}
+
+// Opens the inner archive straight from the encrypted file; nullptr and a
+// reason in `message` if it is not a consistent ZIP archive.
+zip_t* open_payload_archive(const SealedFile& file, std::string& message) {
+    PayloadSource* context = new PayloadSource(file);
+    if (!file.init_cipher(context->cipher)) {
+        delete context;
+        message = "Failed to initialize cipher";
+        return nullptr;
+    }
+
+    zip_error_t error;
+    zip_error_init(&error);
+    zip_source_t* source = zip_source_function_create(payload_source_callback, context, &error);
+    if (!source) {
+        delete context;
+        message = zip_error_strerror(&error);
+        zip_error_fini(&error);
+        return nullptr;
+    }
+
+    zip_t* zip = zip_open_from_source(source, ZIP_RDONLY | ZIP_CHECKCONS, &error);
+    if (!zip) {
+        message = zip_error_strerror(&error);
+        zip_source_free(source);
+    }
+    zip_error_fini(&error);
+    return zip;
+}
+
+// Reads every entry back, letting libzip check sizes and CRCs.
+bool check_entries(const SealedFile& file, unsigned threads, VerifyReport& report) {
+    std::string message;
+    zip_t* zip = open_payload_archive(file, message);
+    if (!zip) {
+        report.error = "Inner archive is damaged: " + message;
+        return false;
+    }
+
+    zip_int64_t count = zip_get_num_entries(zip, 0);
+    for (zip_int64_t i = 0; i < count; i++) {
+        VerifyEntry entry;
+        zip_stat_t st;
+        if (zip_stat_index(zip, i, 0, &st) == 0) {
+            entry.name = (st.valid & ZIP_STAT_NAME) ? st.name : "";
+            entry.size = (st.valid & ZIP_STAT_SIZE) ? st.size : 0;
+        }
+        entry.error = "Not checked";
+        report.entries.push_back(entry);
+    }
+    zip_discard(zip);
+
+    // Each worker reads through its own archive handle
+    std::atomic<std::size_t> next{0};
+    run_workers(static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, report.entries.size()))), [&]() {
+        std::string open_error;
+        zip_t* own = open_payload_archive(file, open_error);
+        if (!own) return;
+
+        PooledBuffer buffer(STREAM_BUFFER_SIZE);
+        for (std::size_t index = next++; index < report.entries.size(); index = next++) {
+            VerifyEntry& entry = report.entries[index];
+            if (!is_safe_path(entry.name)) {
+                entry.error = "Unsafe path";
+                continue;
+            }
+            if (entry.name.back() == '/') {
+                entry.ok = true;
+                entry.error.clear();
+                continue;
+            }
+
+            zip_file_t* data = zip_fopen_index(own, index, 0);
+            if (!data) {
+                entry.error = zip_strerror(own);
+                continue;
+            }
+            uint64_t total = 0;
+            zip_int64_t n;
+            while ((n = zip_fread(data, buffer.data(), buffer.size())) > 0) {
+                total += static_cast<uint64_t>(n);
+            }
+            if (n < 0) {
+                entry.error = zip_file_strerror(data);
+            } else if (total != entry.size) {
+                entry.error = "Size mismatch";
+            } else {
+                entry.ok = true;
+                entry.error.clear();
+            }
+            zip_fclose(data);
+        }
+        zip_discard(own);
+    });
+
+    for (const VerifyEntry& entry : report.entries) {
+        if (!entry.ok) {
+            report.error = "Damaged entry: " + entry.name;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Swallows everything written to it.
+class DiscardBuf : public std::streambuf {
+protected:
+    int_type overflow(int_type ch) override { return traits_type::not_eof(ch); }
+    std::streamsize xsputn(const char*, std::streamsize size) override { return size; }
+};
+
+void verify_legacy(const std::string& input, const std::string& password, VerifyReport& report) {
+    std::ifstream in(input, std::ios::binary);
+    DiscardBuf discard;
+    std::ostream out(&discard);
+    report.ok = in && decrypt_stream(in, out, password, &report.header);
+    if (!report.ok) {
+        report.error = "Decryption failed";
+    }
+}
+
+} // namespace
+
+VerifyReport verify_path(const std::string& input, const std::string& password, unsigned threads) {
+    VerifyReport report;
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    SealedFile file;
+    file.fd = ::open(input.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (file.fd < 0 || ::fstat(file.fd, &st) != 0) {
+        report.error = "Could not open " + input + ": " + std::strerror(errno);
+        return report;
+    }
+    uint64_t file_size = static_cast<uint64_t>(st.st_size);
+
+    file.header_bytes.resize(FILE_HEADER_SIZE);
+    if (file_size < LEGACY_HEADER_SIZE || !pread_full(file.fd, file.header_bytes.data(), LEGACY_HEADER_SIZE, 0)) {
+        report.error = "Encrypted data is too short";
+        return report;
+    }
+    if (std::memcmp(file.header_bytes.data(), VOLUME_MAGIC, sizeof(VOLUME_MAGIC)) == 0) {
+        report.error = "Volume sets are not supported by --verify; decrypt them with -d --targets";
+        return report;
+    }
+    if (!has_file_magic(file.header_bytes.data(), LEGACY_HEADER_SIZE)) {
+        verify_legacy(input, password, report);
+        return report;
+    }
+    if (file_size < FILE_HEADER_SIZE || !pread_full(file.fd, file.header_bytes.data(), FILE_HEADER_SIZE, 0) ||
+        !parse_header(file.header_bytes, file.header)) {
+        report.error = "Invalid file header";
+        return report;
+    }
+    if (file.header.flags & HEADER_FLAG_CONTAINER) {
+        report.error = "Appendable container; use verify_container";
+        return report;
+    }
+    const std::size_t prefix = header_size(file.header.flags);
+    if (prefix > FILE_HEADER_SIZE) {
+        std::vector<uint8_t> key_slots(KEY_SLOTS_SIZE);
+        if (file_size < prefix || !pread_full(file.fd, key_slots.data(), key_slots.size(), FILE_HEADER_SIZE) ||
+            !parse_key_slots(key_slots.data(), key_slots.size(), file.header)) {
+            report.error = "Invalid key slots";
+            return report;
+        }
+    }
+    report.header = file.header;
+
+    uint64_t payload = file_size - prefix;
+    if (!chunk_layout(payload, file.header.chunk_size, file.chunks, file.last_sealed)) {
+        report.error = "Encrypted data is truncated";
+        return report;
+    }
+    file.plain_size = payload - file.chunks * AEAD_TAG_SIZE;
+    report.chunks = file.chunks;
+    report.payload_size = file.plain_size;
+
+    file.key = unlock_file_key(file.header, password);
+    if (file.key.empty()) {
+        report.error = "Wrong password or damaged key slots";
+        return report;
+    }
+
+    uint64_t bad = authenticate_chunks(file, static_cast<unsigned>(std::min<uint64_t>(threads, file.chunks)));
+    if (bad < file.chunks) {
+        report.error = "Authentication failed at chunk " + std::to_string(bad) +
+                       (bad == 0 ? " (wrong password or damaged file)" : "");
+        return report;
+    }
+
+    if (file.header.flags & HEADER_FLAG_RAW_PAYLOAD) {
+        report.ok = true;
+        return report;
+    }
+    report.ok = check_entries(file, threads, report);
+    return report;
+}
@@ -0,0 +1,39 @@
+#ifndef VERIFY_H
+#define VERIFY_H
+
+// Read-only integrity check of encrypted files.
+//
+// Chunks of the current format sit at fixed offsets and each carries its own
+// tag, so after deriving the key once they are authenticated in parallel.
+// The inner ZIP archive is then opened through a source that decrypts chunks
+// on demand, and every entry is read back in memory so libzip checks its
+// structure and CRC. Nothing is written to disk.
+
+#include "internal/format.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VerifyEntry {
+    std::string name;
+    uint64_t size = 0;
+    bool ok = false;
+    std::string error;
+};
+
+struct VerifyReport {
+    bool ok = false;        // Payload authenticated and every entry intact
+    FileHeader header;      // Version LEGACY_FORMAT_VERSION for legacy files
+    uint64_t chunks = 0;
+    uint64_t payload_size = 0;  // Plaintext bytes
+    std::string error;      // First failure; empty when ok
+    std::vector<VerifyEntry> entries;  // Empty for raw payloads and legacy files
+};
+
+// Uses `threads` workers, or one per CPU when 0. Legacy files have neither
+// chunks nor tags; they are decrypted sequentially and only their end marker
+// is checked. Volumes of a set are rejected rather than taken for legacy files.
+VerifyReport verify_path(const std::string& input, const std::string& password, unsigned threads = 0);
+
+#endif // VERIFY_H
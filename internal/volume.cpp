@@ -0,0 +1,365 @@
+#include "internal/volume.h"
+
+#include "internal/cipher.h"
+#include "internal/encryption.h"
+#include "internal/format.h"
+#include "internal/keyslot.h"
+#include "internal/output.h"
+#include "internal/pool.h"
+#include "internal/zip.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+std::string volume_name(const std::string& base, uint32_t index) {
+    char suffix[16];
+    std::snprintf(suffix, sizeof(suffix), ".vol%03u", index + 1);
+    return base + suffix;
+}
+
+std::vector<std::string> volume_targets(const std::vector<std::string>& targets, const std::string& path) {
+    if (!targets.empty()) return targets;
+    std::string parent = fs::path(path).parent_path().string();
+    return {parent.empty() ? "." : parent};
+}
+
+// Offset of the file header within a volume, as change_key_slots expects it.
+constexpr uint64_t VOLUME_FILE_HEADER_OFFSET = VOLUME_HEADER_SIZE - FILE_HEADER_SIZE;
+
+bool read_volume_header(const std::string& path, VolumeHeader& header, uint64_t& size) {
+    FileDescriptor fd(::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    uint8_t bytes[VOLUME_HEADER_SIZE + KEY_SLOTS_SIZE];
+    struct stat st;
+    if (fd.get() < 0 || ::fstat(fd.get(), &st) != 0 || static_cast<uint64_t>(st.st_size) < VOLUME_HEADER_SIZE) {
+        return false;
+    }
+    size = static_cast<uint64_t>(st.st_size);
+    std::size_t length = static_cast<std::size_t>(std::min<uint64_t>(size, sizeof(bytes)));
+    return pread_full(fd.get(), bytes, length, 0) && parse_volume_header(bytes, length, header);
+}
+
+// The volumes of one set, indexed by volume number.
+struct VolumeSet {
+    std::string base;  // Name of the set without the .volNNN suffix
+    std::vector<std::string> paths;
+    std::vector<VolumeHeader> volumes;
+    std::vector<uint64_t> sizes;
+};
+
+// Collects the set `input` belongs to by name from `targets` (or the folder
+// of `input`), keeping only volumes with the same file header. Fails if any
+// volume is missing.
+bool find_volume_set(const std::string& input, const std::vector<std::string>& targets, VolumeSet& set) {
+    VolumeHeader first;
+    uint64_t input_size = 0;
+    if (!read_volume_header(input, first, input_size)) {
+        std::cerr << "Error: Not a volume file: " << input << std::endl;
+        return false;
+    }
+
+    std::string filename = fs::path(input).filename().string();
+    set.base = filename.substr(0, filename.rfind(".vol"));
+    set.paths.assign(first.count, std::string());
+    set.volumes.assign(first.count, VolumeHeader());
+    set.sizes.assign(first.count, 0);
+    for (const std::string& dir : volume_targets(targets, input)) {
+        std::error_code ec;
+        for (const auto& entry : fs::directory_iterator(dir, ec)) {
+            std::string name = entry.path().filename().string();
+            VolumeHeader volume;
+            uint64_t size = 0;
+            if (name.compare(0, set.base.size() + 4, set.base + ".vol") != 0 ||
+                !read_volume_header(entry.path().string(), volume, size) ||
+                volume.count != first.count || volume.file_header != first.file_header ||
+                !set.paths[volume.index].empty()) {
+                continue;
+            }
+            set.paths[volume.index] = entry.path().string();
+            set.volumes[volume.index] = volume;
+            set.sizes[volume.index] = size;
+        }
+        if (ec) {
+            std::cerr << "Warning: Could not read directory " << dir << ": " << ec.message() << std::endl;
+        }
+    }
+
+    for (uint32_t i = 0; i < first.count; ++i) {
+        if (set.paths[i].empty()) {
+            std::cerr << "Error: Missing volume " << i + 1 << " of " << first.count << " ("
+                      << volume_name(set.base, i) << ")" << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+// Encrypts the archive at `archive` into volumes; see encrypt_path_volumes.
+std::vector<std::string> write_volumes(const std::string& archive, const std::string& output_file,
+                                       const std::string& password, const EncryptOptions& options,
+                                       const VolumeOptions& volumes) {
+    FileDescriptor in(::open(archive.c_str(), O_RDONLY | O_CLOEXEC));
+    struct stat st;
+    if (in.get() < 0 || ::fstat(in.get(), &st) != 0) {
+        std::cerr << "Error: Failed to open zip file: " << archive << std::endl;
+        return {};
+    }
+    const uint64_t plain_size = static_cast<uint64_t>(st.st_size);
+
+    FileHeader header;
+    if (!new_file_header(options, header)) {
+        return {};
+    }
+    const uint32_t chunk_size = header.chunk_size;
+    const uint64_t sealed_size = static_cast<uint64_t>(chunk_size) + AEAD_TAG_SIZE;
+    const uint64_t prefix = VOLUME_FILE_HEADER_OFFSET + header_size(header.flags);
+    if (volumes.volume_size < prefix + sealed_size) {
+        std::cerr << "Error: Volume size must be at least " << prefix + sealed_size
+                  << " bytes to hold one chunk." << std::endl;
+        return {};
+    }
+
+    const uint64_t chunks = plain_size == 0 ? 1 : (plain_size + chunk_size - 1) / chunk_size;
+    const uint64_t per_volume = (volumes.volume_size - prefix) / sealed_size;
+    const uint64_t count = (chunks + per_volume - 1) / per_volume;
+    if (count > UINT32_MAX) {
+        std::cerr << "Error: Volume size is too small for this input." << std::endl;
+        return {};
+    }
+
+    SecureBytes key = new_data_key(header, password);
+    if (key.empty()) {
+        return {};
+    }
+    const std::vector<uint8_t> header_bytes = serialize_header(header);
+    const std::vector<uint8_t> key_slots = serialize_key_slots(header);
+    const std::vector<std::string> targets = volume_targets(volumes.targets, output_file);
+    const std::string base = fs::path(output_file).filename().string();
+
+    std::vector<std::string> written(count);
+    std::atomic<bool> failed{false};
+
+    auto write_volume = [&](ChunkCipher& cipher, uint32_t index, const std::string& dir, PooledBuffer& plain,
+                            PooledBuffer& sealed) {
+        VolumeHeader volume;
+        volume.index = index;
+        volume.count = static_cast<uint32_t>(count);
+        volume.first_chunk = index * per_volume;
+        volume.chunks = std::min(per_volume, chunks - volume.first_chunk);
+        volume.file_header = header_bytes;
+        volume.key_slots = key_slots;
+
+        uint64_t end = volume.first_chunk + volume.chunks;
+        uint64_t volume_plain = std::min(plain_size, end * chunk_size) - volume.first_chunk * chunk_size;
+        AtomicFileWriter out;
+        if (!out.open((fs::path(dir) / volume_name(base, index)).string(),
+                      prefix + volume_plain + volume.chunks * AEAD_TAG_SIZE)) {
+            return false;
+        }
+
+        std::vector<uint8_t> volume_header = serialize_volume_header(volume);
+        out.stream().write(reinterpret_cast<const char*>(volume_header.data()), volume_header.size());
+        for (uint64_t chunk = volume.first_chunk; chunk < end; ++chunk) {
+            std::size_t length = static_cast<std::size_t>(std::min<uint64_t>(chunk_size, plain_size - chunk * chunk_size));
+            if (!pread_full(in.get(), plain.data(), length, chunk * chunk_size) ||
+                !cipher.seal(chunk, chunk + 1 == chunks, plain.data(), length, sealed.data())) {
+                std::cerr << "Error: Encryption failed at chunk " << chunk << std::endl;
+                return false;
+            }
+            out.stream().write(reinterpret_cast<const char*>(sealed.data()), length + AEAD_TAG_SIZE);
+        }
+        if (!out.stream()) {
+            std::cerr << "Error: Failed to write volume " << index + 1 << " to " << dir << std::endl;
+            return false;
+        }
+        written[index] = out.commit();
+        return !written[index].empty();
+    };
+
+    // One writer per target directory, each filling its volumes in turn
+    std::vector<std::thread> writers;
+    for (std::size_t t = 0; t < targets.size() && t < count; ++t) {
+        writers.emplace_back([&, t]() {
+            ChunkCipher cipher;
+            if (!cipher.init(*find_cipher_suite(header.suite), key, header.nonce, header_bytes, true)) {
+                failed = true;
+                return;
+            }
+            PooledBuffer plain(chunk_size);
+            PooledBuffer sealed(sealed_size);
+            for (uint64_t index = t; index < count && !failed; index += targets.size()) {
+                if (!write_volume(cipher, static_cast<uint32_t>(index), targets[t], plain, sealed)) {
+                    failed = true;
+                }
+            }
+        });
+    }
+    for (std::thread& writer : writers) {
+        writer.join();
+    }
+    secure_clear(key);
+
+    if (failed) {
+        for (const std::string& path : written) {
+            if (!path.empty()) ::unlink(path.c_str());
+        }
+        return {};
+    }
+    return written;
+}
+
+} // namespace
+
+std::vector<std::string> encrypt_path_volumes(const std::string& input, const std::string& output_file,
+                                              const std::string& password, const EncryptOptions& options,
+                                              const VolumeOptions& volumes) {
+    std::string temp_zip = make_temp_path(input) + ".zip";
+    if (!archive_path(input, temp_zip)) {
+        std::cerr << "Error: Failed to create zip file" << std::endl;
+        delete_zip(temp_zip);
+        return {};
+    }
+
+    std::vector<std::string> written = write_volumes(temp_zip, output_file, password, options, volumes);
+    delete_zip(temp_zip);
+    return written;
+}
+
+bool is_volume_file(const std::string& path) {
+    VolumeHeader header;
+    uint64_t size = 0;
+    return read_volume_header(path, header, size);
+}
+
+bool decrypt_volumes(const std::string& input, const std::vector<std::string>& targets,
+                     const std::string& output_folder, const std::string& password) {
+    VolumeSet set;
+    if (!find_volume_set(input, targets, set)) {
+        return false;
+    }
+    const VolumeHeader& first = set.volumes[0];
+    FileHeader header;
+    if (!parse_header(first.file_header, header) ||
+        (!first.key_slots.empty() && !parse_key_slots(first.key_slots.data(), first.key_slots.size(), header))) {
+        return false;
+    }
+
+    // Volumes must hold consecutive runs of full chunks; only the last may end short
+    const uint32_t chunk_size = header.chunk_size;
+    const uint64_t sealed_size = static_cast<uint64_t>(chunk_size) + AEAD_TAG_SIZE;
+    uint64_t total = 0;
+    uint64_t last_sealed = sealed_size;
+    const std::vector<std::string>& paths = set.paths;
+    const std::vector<VolumeHeader>& volumes = set.volumes;
+    for (uint32_t i = 0; i < first.count; ++i) {
+        uint64_t payload = set.sizes[i] - volume_header_size(volumes[i]);
+        uint64_t chunks = 0;
+        bool laid_out = i + 1 == first.count ? chunk_layout(payload, chunk_size, chunks, last_sealed)
+                                             : payload % sealed_size == 0 && (chunks = payload / sealed_size) > 0;
+        if (!laid_out || volumes[i].first_chunk != total || volumes[i].chunks != chunks) {
+            std::cerr << "Error: Volume is truncated or out of place: " << paths[i] << std::endl;
+            return false;
+        }
+        total += chunks;
+    }
+    const uint64_t plain_size = (total - 1) * chunk_size + last_sealed - AEAD_TAG_SIZE;
+
+    std::string name = set.base;
+    if (fs::path(name).extension() == ".enc") name = fs::path(name).replace_extension().string();
+    try {
+        fs::create_directories(output_folder);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error: Could not create output directory: " << e.what() << std::endl;
+        return false;
+    }
+    AtomicFileWriter out;
+    if (!out.open((fs::path(output_folder) / name).string(), plain_size)) {
+        return false;
+    }
+
+    SecureBytes key = unlock_file_key(header, password);
+    if (key.empty()) {
+        return false;
+    }
+
+    // One reader per directory; chunks land at their final plaintext offset
+    std::map<std::string, std::vector<uint32_t>> by_dir;
+    for (uint32_t i = 0; i < first.count; ++i) {
+        by_dir[fs::path(paths[i]).parent_path().string()].push_back(i);
+    }
+
+    std::atomic<bool> failed{false};
+    std::vector<std::thread> readers;
+    for (const auto& group : by_dir) {
+        const std::vector<uint32_t>& indices = group.second;
+        readers.emplace_back([&, indices]() {
+            ChunkCipher cipher;
+            if (!cipher.init(*find_cipher_suite(header.suite), key, header.nonce, first.file_header, false)) {
+                failed = true;
+                return;
+            }
+            PooledBuffer sealed(sealed_size);
+            PooledBuffer plain(chunk_size);
+            for (uint32_t i : indices) {
+                FileDescriptor in(::open(paths[i].c_str(), O_RDONLY | O_CLOEXEC));
+                const VolumeHeader& volume = volumes[i];
+                for (uint64_t chunk = volume.first_chunk; chunk < volume.first_chunk + volume.chunks && !failed; ++chunk) {
+                    std::size_t length = chunk + 1 == total ? last_sealed : sealed_size;
+                    uint64_t offset = volume_header_size(volume) + (chunk - volume.first_chunk) * sealed_size;
+                    if (in.get() < 0 || !pread_full(in.get(), sealed.data(), length, offset)) {
+                        std::cerr << "Error: Failed to read volume: " << paths[i] << std::endl;
+                        failed = true;
+                    } else if (!cipher.open(chunk, chunk + 1 == total, sealed.data(), length, plain.data())) {
+                        std::cerr << "Error: Authentication failed at chunk " << chunk << " in " << paths[i] << std::endl;
+                        failed = true;
+                    } else if (!pwrite_full(out.fd(), plain.data(), length - AEAD_TAG_SIZE, chunk * chunk_size)) {
+                        std::cerr << "Error: Failed to write decrypted output" << std::endl;
+                        failed = true;
+                    }
+                }
+            }
+        });
+    }
+    for (std::thread& reader : readers) {
+        reader.join();
+    }
+    secure_clear(key);
+
+    if (failed || !out.resize(plain_size)) {
+        std::cerr << "Error: Decryption failed - wrong password or corrupted volumes" << std::endl;
+        return false;
+    }
+
+    if (header.flags & HEADER_FLAG_RAW_PAYLOAD) {
+        std::string target = out.commit();
+        if (target.empty()) {
+            return false;
+        }
+        std::cout << "Raw payload written: " << target << std::endl;
+        return true;
+    }
+
+    if (!unzip_file(out.read_path(), output_folder, true)) {
+        std::cerr << "Error: Failed to extract files" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+bool rekey_volumes(const std::string& input, const std::vector<std::string>& targets, const std::string& password,
+                   const KeySlotUpdate& update) {
+    VolumeSet set;
+    if (!find_volume_set(input, targets, set)) {
+        return false;
+    }
+    return change_key_slots(set.paths, VOLUME_FILE_HEADER_OFFSET, password, update);
+}
@@ -0,0 +1,44 @@
+#ifndef VOLUME_H
+#define VOLUME_H
+
+// Multi-volume output (layout in internal/format.h).
+//
+// The encrypted stream is cut into volumes of whole chunks, named
+// <output>.vol001, <output>.vol002, ... and dealt round-robin over the target
+// directories. One thread per directory writes its volumes, so independent
+// disks are filled concurrently; decryption reads them back the same way and
+// writes each chunk at its final offset.
+
+#include "internal/encryptor.h"
+#include "internal/keyslot.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+struct VolumeOptions {
+    uint64_t volume_size = 0;          // Upper bound per volume, in bytes
+    std::vector<std::string> targets;  // Directories; empty = next to the output
+};
+
+// Archives and encrypts `input` into volumes named after `output_file`.
+// Returns the written volume paths in order, or an empty list on failure
+// (no volume is left behind then).
+std::vector<std::string> encrypt_path_volumes(const std::string& input, const std::string& output_file,
+                                              const std::string& password, const EncryptOptions& options,
+                                              const VolumeOptions& volumes);
+
+// True if `path` starts with a volume header.
+bool is_volume_file(const std::string& path);
+
+// Decrypts the set `input` belongs to. Volumes are looked up by name in
+// `targets`, or next to `input` if none are given, and matched by header.
+bool decrypt_volumes(const std::string& input, const std::vector<std::string>& targets,
+                     const std::string& output_folder, const std::string& password);
+
+// Applies `update` to the key slots of every volume in the set `input`
+// belongs to; all volumes must be present.
+bool rekey_volumes(const std::string& input, const std::vector<std::string>& targets, const std::string& password,
+                   const KeySlotUpdate& update);
+
+#endif // VOLUME_H
@@ -0,0 +1,46 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+// Work-stealing scheduler for batches of independent jobs.
+//
+// Every worker owns a deque. Jobs are dealt round-robin before the run
+// starts; a worker takes jobs from the front of its own deque and, once that
+// is empty, steals from the back of another worker's. Submitting jobs
+// largest first puts the big ones at the fronts, so they start early, while
+// workers that run dry pick off the small ones queued elsewhere.
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    // Uses one worker per CPU when `threads` is 0.
+    explicit WorkStealingPool(unsigned threads = 0);
+
+    // Queues a job. Jobs must not submit further jobs.
+    void submit(std::function<void()> job);
+
+    // Runs every queued job on the workers, the calling thread included, and
+    // returns once all have finished.
+    void run();
+
+    unsigned threads() const { return static_cast<unsigned>(queues_.size()); }
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<std::function<void()>> jobs;
+    };
+
+    bool take(std::size_t self, std::function<void()>& job);
+    void work(std::size_t self);
+
+    std::vector<std::unique_ptr<Queue>> queues_;
+    std::size_t next_queue_ = 0;
+};
+
+#endif // WORKPOOL_H
@@ -0,0 +1,568 @@
+#include "internal/zip.h"
+
+#include "internal/directory.h"
+#include "internal/format.h"
+#include "internal/output.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <map>
+#include <utility>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+// Private ZIP extra fields (central directory) describing how an entry is rebuilt
+constexpr zip_uint16_t EXTRA_SPARSE_MAP = 0x7370;  // "sp": entry data holds only these extents
+constexpr zip_uint16_t EXTRA_HARDLINK = 0x686C;    // "hl": entry is a link to an earlier entry
+
+// Sparse map: logical size (8) | extent count (4) | [offset (8) | length (8)]...
+// An extra field holds at most 64 KiB; files with more extents are stored densely.
+constexpr std::size_t SPARSE_MAP_HEADER = 12;
+constexpr std::size_t SPARSE_EXTENT_SIZE = 16;
+constexpr std::size_t MAX_SPARSE_EXTENTS = 4000;
+
+struct Extent {
+    uint64_t offset;
+    uint64_t length;
+};
+
+// Lists the data regions of a file with holes. Returns false for dense files
+// and when the filesystem cannot report holes.
+bool map_sparse_extents(const std::string& path, uint64_t& logical_size, std::vector<Extent>& extents) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    struct stat st;
+    bool sparse = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+                  static_cast<uint64_t>(st.st_blocks) * 512 < static_cast<uint64_t>(st.st_size);
+    extents.clear();
+    logical_size = sparse ? static_cast<uint64_t>(st.st_size) : 0;
+
+    off_t offset = 0;
+    while (sparse && static_cast<uint64_t>(offset) < logical_size) {
+        off_t data = ::lseek(fd, offset, SEEK_DATA);
+        if (data < 0) {
+            sparse = errno == ENXIO;  // ENXIO: only a hole remains
+            break;
+        }
+        off_t hole = ::lseek(fd, data, SEEK_HOLE);
+        if (hole < 0 || extents.size() == MAX_SPARSE_EXTENTS) {
+            sparse = false;
+            break;
+        }
+        extents.push_back({static_cast<uint64_t>(data), static_cast<uint64_t>(hole - data)});
+        offset = hole;
+    }
+
+    ::close(fd);
+    return sparse;
+}
+
+std::vector<uint8_t> encode_sparse_map(uint64_t logical_size, const std::vector<Extent>& extents) {
+    std::vector<uint8_t> field(SPARSE_MAP_HEADER + extents.size() * SPARSE_EXTENT_SIZE);
+    put_u64(field.data(), logical_size);
+    put_u32(field.data() + 8, static_cast<uint32_t>(extents.size()));
+    uint8_t* out = field.data() + SPARSE_MAP_HEADER;
+    for (const Extent& extent : extents) {
+        put_u64(out, extent.offset);
+        put_u64(out + 8, extent.length);
+        out += SPARSE_EXTENT_SIZE;
+    }
+    return field;
+}
+
+// Rejects maps whose extents overlap, run past the logical size or do not
+// add up to the stored data.
+bool decode_sparse_map(const zip_uint8_t* field, zip_uint16_t length, uint64_t data_size,
+                       uint64_t& logical_size, std::vector<Extent>& extents) {
+    if (length < SPARSE_MAP_HEADER) return false;
+    logical_size = get_u64(field);
+    uint32_t count = get_u32(field + 8);
+    if (length != SPARSE_MAP_HEADER + static_cast<std::size_t>(count) * SPARSE_EXTENT_SIZE) return false;
+
+    extents.clear();
+    uint64_t end = 0;
+    uint64_t total = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        const zip_uint8_t* in = field + SPARSE_MAP_HEADER + i * SPARSE_EXTENT_SIZE;
+        Extent extent{get_u64(in), get_u64(in + 8)};
+        if (extent.offset < end || extent.length > logical_size - extent.offset) return false;
+        end = extent.offset + extent.length;
+        total += extent.length;
+        extents.push_back(extent);
+    }
+    return total == data_size;
+}
+
+// Zip source streaming only the data extents of a sparse file, so holes are
+// neither read nor compressed.
+struct SparseSource {
+    std::string path;
+    std::vector<Extent> extents;
+    uint64_t data_size = 0;
+    time_t mtime = 0;
+    int fd = -1;
+    std::size_t extent = 0;
+    uint64_t extent_offset = 0;
+    zip_error_t error;
+};
+
+zip_int64_t sparse_source_callback(void* userdata, void* data, zip_uint64_t length, zip_source_cmd_t command) {
+    SparseSource* source = static_cast<SparseSource*>(userdata);
+
+    switch (command) {
+    case ZIP_SOURCE_OPEN:
+        source->fd = ::open(source->path.c_str(), O_RDONLY | O_CLOEXEC);
+        if (source->fd < 0) {
+            zip_error_set(&source->error, ZIP_ER_OPEN, errno);
+            return -1;
+        }
+        source->extent = 0;
+        source->extent_offset = 0;
+        return 0;
+
+    case ZIP_SOURCE_READ: {
+        uint8_t* out = static_cast<uint8_t*>(data);
+        zip_uint64_t produced = 0;
+        while (produced < length && source->extent < source->extents.size()) {
+            const Extent& extent = source->extents[source->extent];
+            uint64_t want = std::min<uint64_t>(length - produced, extent.length - source->extent_offset);
+            ssize_t n = ::pread(source->fd, out + produced, want,
+                                static_cast<off_t>(extent.offset + source->extent_offset));
+            if (n < 0 && errno == EINTR) continue;
+            if (n <= 0) {
+                // The file shrank since it was mapped
+                zip_error_set(&source->error, ZIP_ER_READ, n < 0 ? errno : EIO);
+                return -1;
+            }
+            produced += static_cast<zip_uint64_t>(n);
+            source->extent_offset += static_cast<uint64_t>(n);
+            if (source->extent_offset == extent.length) {
+                source->extent++;
+                source->extent_offset = 0;
+            }
+        }
+        return static_cast<zip_int64_t>(produced);
+    }
+
+    case ZIP_SOURCE_CLOSE:
+        if (source->fd >= 0) ::close(source->fd);
+        source->fd = -1;
+        return 0;
+
+    case ZIP_SOURCE_STAT: {
+        zip_stat_t* st = static_cast<zip_stat_t*>(data);
+        zip_stat_init(st);
+        st->size = source->data_size;
+        st->mtime = source->mtime;
+        st->valid |= ZIP_STAT_SIZE | ZIP_STAT_MTIME;
+        return sizeof(*st);
+    }
+
+    case ZIP_SOURCE_ERROR:
+        return zip_error_to_data(&source->error, data, length);
+
+    case ZIP_SOURCE_FREE:
+        if (source->fd >= 0) ::close(source->fd);
+        zip_error_fini(&source->error);
+        delete source;
+        return 0;
+
+    case ZIP_SOURCE_SUPPORTS:
+        return zip_source_make_command_bitmap(ZIP_SOURCE_OPEN, ZIP_SOURCE_READ, ZIP_SOURCE_CLOSE,
+                                              ZIP_SOURCE_STAT, ZIP_SOURCE_ERROR, ZIP_SOURCE_FREE, -1);
+
+    default:
+        zip_error_set(&source->error, ZIP_ER_INTERNAL, 0);
+        return -1;
+    }
+}
+
+// Adds a regular file; sparse files keep only their data plus an extent map.
+// Returns the entry index, or -1.
+zip_int64_t add_file_entry(zip_t* zip, const std::string& file_path, const std::string& archive_path) {
+    uint64_t logical_size = 0;
+    std::vector<Extent> extents;
+    if (!map_sparse_extents(file_path, logical_size, extents)) {
+        zip_source_t* source = zip_source_file(zip, file_path.c_str(), 0, 0);
+        if (!source) return -1;
+        zip_int64_t index = zip_file_add(zip, archive_path.c_str(), source, ZIP_FL_OVERWRITE);
+        if (index < 0) zip_source_free(source);
+        return index;
+    }
+
+    std::vector<uint8_t> field = encode_sparse_map(logical_size, extents);
+
+    SparseSource* context = new SparseSource;
+    context->path = file_path;
+    context->extents = std::move(extents);
+    for (const Extent& extent : context->extents) context->data_size += extent.length;
+    struct stat st;
+    if (::stat(file_path.c_str(), &st) == 0) context->mtime = st.st_mtime;
+    zip_error_init(&context->error);
+
+    zip_source_t* source = zip_source_function(zip, sparse_source_callback, context);
+    if (!source) {
+        zip_error_fini(&context->error);
+        delete context;
+        return -1;
+    }
+
+    zip_int64_t index = zip_file_add(zip, archive_path.c_str(), source, ZIP_FL_OVERWRITE);
+    if (index < 0) {
+        zip_source_free(source);
+        return -1;
+    }
+    if (zip_file_extra_field_set(zip, index, EXTRA_SPARSE_MAP, ZIP_EXTRA_FIELD_NEW, field.data(),
+                                 static_cast<zip_uint16_t>(field.size()), ZIP_FL_CENTRAL) < 0) {
+        zip_delete(zip, index);
+        return -1;
+    }
+    return index;
+}
+
+// Adds an empty entry pointing at the archive path of another link to the same inode
+zip_int64_t add_hardlink_entry(zip_t* zip, const std::string& archive_path, const std::string& target) {
+    zip_source_t* source = zip_source_buffer(zip, nullptr, 0, 0);
+    if (!source) return -1;
+
+    zip_int64_t index = zip_file_add(zip, archive_path.c_str(), source, ZIP_FL_OVERWRITE);
+    if (index < 0) {
+        zip_source_free(source);
+        return -1;
+    }
+    if (zip_file_extra_field_set(zip, index, EXTRA_HARDLINK, ZIP_EXTRA_FIELD_NEW,
+                                 reinterpret_cast<const zip_uint8_t*>(target.data()),
+                                 static_cast<zip_uint16_t>(target.size()), ZIP_FL_CENTRAL) < 0) {
+        zip_delete(zip, index);
+        return -1;
+    }
+    return index;
+}
+
+}  // namespace
+
+int is_file_or_folder(const std::string& path) {
+    try {
+        if (fs::is_regular_file(path)) {
+            return 1;  // File
+        } else if (fs::is_directory(path)) {
+            return 0;  // Directory
+        } else {
+            std::cerr << "Error: Path is neither a file nor a folder: " << path << std::endl;
+            return -1;
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error checking path: " << e.what() << std::endl;
+        return -1;
+    }
+}
+
+void delete_zip(const std::string& path) {
+    try {
+        if (fs::exists(path)) {
+            std::size_t removed_count = fs::remove_all(path);
+            if (removed_count == 0) {
+                std::cerr << "Warning: No files were deleted at: " << path << std::endl;
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error deleting file/folder: " << e.what() << std::endl;
+    }
+}
+
+// Path sanitization to prevent directory traversal attacks
+bool is_safe_path(const std::string& path) {
+    return path.find("..") == std::string::npos && 
+           path.find("//") == std::string::npos &&
+           !path.empty() && 
+           (path[0] != '/' || path.find_first_not_of('/') != std::string::npos);
+}
+
+bool zip_file(const std::string& input_file, const std::string& zip_path) {
+    int error = 0;
+
+    zip_t* zip = zip_open(zip_path.c_str(), ZIP_CREATE, &error);
+    if (!zip) {
+        std::cerr << "Error: Could not create ZIP archive: " << zip_path << std::endl;
+        return false;
+    }
+
+    // Use only the filename, not the full path, to avoid unnecessary directories
+    std::string filename = fs::path(input_file).filename().string();
+    
+    // Add file with just the filename (no path)
+    if (add_file_entry(zip, input_file, filename) < 0) {
+        std::cerr << "Error: Could not add file to ZIP archive: " << input_file << std::endl;
+        zip_close(zip);
+        return false;
+    }
+
+    if (zip_close(zip) != 0) {
+        std::cerr << "Error: Could not close ZIP archive." << std::endl;
+        return false;
+    }
+
+    std::cout << "File successfully zipped: " << zip_path << std::endl;
+    return true;
+}
+
+bool zip_folder(const std::string& folder_path, const std::string& zip_path) {
+    int error = 0;
+
+    zip_t* zip = zip_open(zip_path.c_str(), ZIP_CREATE | ZIP_TRUNCATE, &error);
+    if (!zip) {
+        std::cerr << "Error: Could not create ZIP archive: " << zip_path << std::endl;
+        return false;
+    }
+
+    try {
+        // Get the folder name to preserve directory structure
+        std::string folder_name = fs::path(folder_path).filename().string();
+        
+        // First, add all directories (including empty ones)
+        for (const auto& entry : fs::recursive_directory_iterator(folder_path)) {
+            if (entry.is_directory()) {
+                // Get relative path from the parent of folder_path
+                fs::path relative_path = fs::relative(entry.path(), fs::path(folder_path).parent_path());
+                std::string dir_path = relative_path.string() + "/";
+                
+                // Add directory entry
+                if (zip_dir_add(zip, dir_path.c_str(), ZIP_FL_ENC_UTF_8) < 0) {
+                    std::cerr << "Warning: Could not add directory: " << dir_path << std::endl;
+                }
+            }
+        }
+        
+        // Then add all files; further links to an already stored inode only
+        // reference the first one
+        std::map<std::pair<dev_t, ino_t>, std::string> stored_links;
+        for (const auto& entry : fs::recursive_directory_iterator(folder_path)) {
+            if (entry.is_regular_file()) {
+                std::string file_path = entry.path().string();
+                
+                // Get relative path from the parent of folder_path to preserve structure
+                fs::path relative_path = fs::relative(entry.path(), fs::path(folder_path).parent_path());
+                std::string archive_path = relative_path.string();
+
+                struct stat st;
+                bool linked = !entry.is_symlink() && ::lstat(file_path.c_str(), &st) == 0 && st.st_nlink > 1;
+                if (linked) {
+                    auto stored = stored_links.find({st.st_dev, st.st_ino});
+                    if (stored != stored_links.end()) {
+                        if (add_hardlink_entry(zip, archive_path, stored->second) < 0) {
+                            std::cerr << "Warning: Could not add hard link to ZIP: " << file_path << std::endl;
+                        }
+                        continue;
+                    }
+                }
+
+                if (add_file_entry(zip, file_path, archive_path) < 0) {
+                    std::cerr << "Warning: Could not add file to ZIP: " << file_path << std::endl;
+                    continue;
+                }
+                if (linked) stored_links.emplace(std::make_pair(st.st_dev, st.st_ino), archive_path);
+            }
+        }
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error iterating directory: " << e.what() << std::endl;
+        zip_close(zip);
+        return false;
+    }
+
+    if (zip_close(zip) != 0) {
+        std::cerr << "Error: Could not close ZIP archive." << std::endl;
+        return false;
+    }
+
+    std::cout << "Folder successfully zipped: " << zip_path << std::endl;
+    return true;
+}
+
+bool unzip_file(const std::string& zip_path, const std::string& output_folder, bool strip_redundant_root) {
+    int error = 0;
+
+    zip_t* zip = zip_open(zip_path.c_str(), ZIP_RDONLY, &error);
+    if (!zip) {
+        std::cerr << "Error: Could not open ZIP archive: " << zip_path << std::endl;
+        return false;
+    }
+
+    zip_int64_t num_entries = zip_get_num_entries(zip, 0);
+    if (num_entries < 0) {
+        std::cerr << "Error: Could not read ZIP archive entries." << std::endl;
+        zip_close(zip);
+        return false;
+    }
+
+    // Create output directory
+    try {
+        fs::create_directories(output_folder);
+    } catch (const fs::filesystem_error& e) {
+        std::cerr << "Error: Could not create output directory: " << e.what() << std::endl;
+        zip_close(zip);
+        return false;
+    }
+
+    // Work out the redundant folder chain from the entry list alone
+    std::string strip_prefix;
+    if (strip_redundant_root) {
+        std::vector<std::string> names;
+        names.reserve(num_entries);
+        for (zip_int64_t i = 0; i < num_entries; i++) {
+            const char* name = zip_get_name(zip, i, 0);
+            if (name && is_safe_path(name)) {
+                names.emplace_back(name);
+            }
+        }
+        strip_prefix = find_redundant_prefix(names);
+        if (strip_prefix.empty()) {
+            std::cout << "No unnecessary nesting detected.\n";
+        } else {
+            std::cout << "Detected unnecessary nesting in: " << strip_prefix << "\n";
+        }
+    }
+
+    // Extract all entries
+    for (zip_int64_t i = 0; i < num_entries; i++) {
+        struct zip_stat file_stat;
+        if (zip_stat_index(zip, i, 0, &file_stat) != 0) {
+            std::cerr << "Warning: Could not retrieve info for entry " << i << std::endl;
+            continue;
+        }
+
+        std::string filename = file_stat.name;
+        
+        // Security check - prevent directory traversal
+        if (!is_safe_path(filename)) {
+            std::cerr << "Warning: Skipping unsafe path: " << filename << std::endl;
+            continue;
+        }
+
+        if (!strip_prefix.empty()) {
+            if (filename.compare(0, strip_prefix.size(), strip_prefix) != 0) continue;
+            filename.erase(0, strip_prefix.size());
+            if (filename.empty()) continue;  // One of the stripped folders
+        }
+
+        // Use proper path handling
+        fs::path output_path = fs::path(output_folder) / filename;
+
+        // Handle directories
+        if (!filename.empty() && filename.back() == '/') {
+            try {
+                fs::create_directories(output_path);
+            } catch (const fs::filesystem_error& e) {
+                std::cerr << "Warning: Could not create directory: " << e.what() << std::endl;
+            }
+            continue;
+        }
+
+        // Handle hard links to an entry extracted earlier
+        zip_uint16_t field_length = 0;
+        const zip_uint8_t* field = zip_file_extra_field_get_by_id(zip, i, EXTRA_HARDLINK, 0, &field_length, ZIP_FL_CENTRAL);
+        if (field) {
+            std::string target(reinterpret_cast<const char*>(field), field_length);
+            if (!is_safe_path(target) || target.compare(0, strip_prefix.size(), strip_prefix) != 0) {
+                std::cerr << "Warning: Skipping hard link with unsafe target: " << filename << std::endl;
+                continue;
+            }
+            fs::path target_path = fs::path(output_folder) / target.substr(strip_prefix.size());
+            std::error_code ec;
+            fs::create_directories(output_path.parent_path(), ec);
+            fs::remove(output_path, ec);
+            fs::create_hard_link(target_path, output_path, ec);
+            if (ec) {
+                // Cross-device or unsupported: fall back to a copy
+                ec.clear();
+                fs::copy_file(target_path, output_path, fs::copy_options::overwrite_existing, ec);
+            }
+            if (ec) {
+                std::cerr << "Warning: Could not restore hard link " << filename << ": " << ec.message() << std::endl;
+            }
+            continue;
+        }
+
+        // Sparse entries hold only the data extents
+        uint64_t logical_size = 0;
+        std::vector<Extent> extents;
+        field = zip_file_extra_field_get_by_id(zip, i, EXTRA_SPARSE_MAP, 0, &field_length, ZIP_FL_CENTRAL);
+        bool sparse = field && (file_stat.valid & ZIP_STAT_SIZE);
+        if (sparse && !decode_sparse_map(field, field_length, file_stat.size, logical_size, extents)) {
+            std::cerr << "Warning: Ignoring malformed sparse map for: " << filename << std::endl;
+            sparse = false;
+        }
+
+        // Handle files
+        zip_file_t* file = zip_fopen_index(zip, i, 0);
+        if (!file) {
+            std::cerr << "Warning: Could not open file in ZIP: " << filename << std::endl;
+            continue;
+        }
+
+        // Ensure parent directories exist
+        try {
+            fs::create_directories(output_path.parent_path());
+        } catch (const fs::filesystem_error& e) {
+            std::cerr << "Warning: Could not create parent directories: " << e.what() << std::endl;
+            zip_fclose(file);
+            continue;
+        }
+
+        // Extract the file; it only appears once it has been written completely
+        AtomicFileWriter out_file;
+        // Sparse files are not preallocated, which would fill their holes
+        uint64_t expected_size = (file_stat.valid & ZIP_STAT_SIZE) && !sparse ? file_stat.size : 0;
+        if (!out_file.open(output_path.string(), expected_size)) {
+            std::cerr << "Warning: Could not create output file: " << output_path << std::endl;
+            zip_fclose(file);
+            continue;
+        }
+
+        // Read and write file data; a dense entry is one region running to the
+        // end of the data, a sparse one skips the holes between its extents
+        PooledBuffer buffer(STREAM_BUFFER_SIZE);
+        std::vector<Extent> regions = sparse ? extents : std::vector<Extent>{{0, UINT64_MAX}};
+        bool read_failed = false;
+        bool write_failed = false;
+        for (const Extent& region : regions) {
+            if (sparse) out_file.stream().seekp(static_cast<std::streamoff>(region.offset));
+            uint64_t remaining = region.length;
+            while (remaining > 0) {
+                zip_int64_t bytes_read = zip_fread(file, buffer.data(), std::min<uint64_t>(remaining, buffer.size()));
+                if (bytes_read <= 0) {
+                    read_failed = bytes_read < 0 || sparse;
+                    break;
+                }
+                out_file.stream().write(reinterpret_cast<const char*>(buffer.data()), bytes_read);
+                if (!out_file.stream()) {
+                    std::cerr << "Error: Failed to write to output file: " << output_path << std::endl;
+                    write_failed = true;
+                    break;
+                }
+                remaining -= static_cast<uint64_t>(bytes_read);
+            }
+            if (read_failed || write_failed) break;
+        }
+        if (sparse && !read_failed && !write_failed && !out_file.resize(logical_size)) {
+            std::cerr << "Error: Failed to write to output file: " << output_path << std::endl;
+            write_failed = true;
+        }
+
+        zip_fclose(file);
+
+        if (read_failed) {
+            std::cerr << "Warning: Error reading file from ZIP: " << filename << std::endl;
+        } else if (!write_failed) {
+            out_file.commit(PublishMode::REPLACE);
+        }
+    }
+
+    zip_close(zip);
+    std::cout << "Extraction completed: " << output_folder << std::endl;
+    return true;
+}
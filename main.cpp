@@ -1,19 +1,224 @@
-#include "internal/directory.h"
+#include "internal/bulk.h"
+#include "internal/container.h"
 #include "internal/encryption.h"
+#include "internal/encryptor.h"
+#include "internal/keyslot.h"
+#include "internal/output.h"
+#include "internal/resume.h"
+#include "internal/verify.h"
+#include "internal/volume.h"
 #include "cmd/cli.h"
-#include "internal/zip.h"
+
+#include <iomanip>
+
+// Turns the --kdf* flags into KDF parameters, calibrating them if asked to
+static bool build_kdf_params(const CliOptions& options, KdfParams& params, std::ostream& log) {
+    KdfId id = KdfId::PBKDF2_SHA256;
+    if (!options.kdf.empty() && !parse_kdf_name(options.kdf, id)) {
+        std::cerr << "Error: Unknown key derivation function: " << options.kdf << std::endl;
+        return false;
+    }
+    if (id == KdfId::ARGON2ID && !argon2id_available()) {
+        std::cerr << "Error: Argon2id requires OpenSSL 3.2 or newer." << std::endl;
+        return false;
+    }
+    if (id != KdfId::ARGON2ID && (options.kdf_memory_mib || options.kdf_lanes)) {
+        std::cerr << "Error: --kdf-memory and --kdf-lanes only apply to argon2id." << std::endl;
+        return false;
+    }
+
+    // Range-check before converting to KiB, which would wrap in 32 bits
+    if (options.kdf_memory_mib > MAX_ARGON2_MEMORY_KIB / 1024) {
+        std::cerr << "Error: --kdf-memory is limited to " << MAX_ARGON2_MEMORY_KIB / 1024 << " MiB." << std::endl;
+        return false;
+    }
+
+    params = default_kdf_params(id);
+    if (options.kdf_memory_mib) params.memory_kib = options.kdf_memory_mib * 1024;
+    if (options.kdf_lanes) params.lanes = options.kdf_lanes;
+    if (!validate_kdf_params(params)) {
+        std::cerr << "Error: Invalid key derivation parameters." << std::endl;
+        return false;
+    }
+
+    if (options.kdf_target_ms) {
+        log << "Calibrating " << kdf_name(id) << " for " << options.kdf_target_ms << " ms..." << std::endl;
+        params = calibrate_kdf(params, options.kdf_target_ms);
+    }
+    log << "Key derivation: " << kdf_name(params.id) << ", "
+              << params.iterations << (id == KdfId::ARGON2ID ? " passes" : " iterations");
+    if (id == KdfId::ARGON2ID) {
+        log << ", " << params.memory_kib / 1024 << " MiB, " << params.lanes << " lanes";
+    }
+    log << std::endl;
+    return true;
+}
 
 int main(int argc, char* argv[]) {
-    const int length = 32;
-    const int iterations = 100000;
     std::string password, mode, input, output;
+    CliOptions options;
 
     // Get CLI parameters
-    if (cli(argc, argv, input, output, password, mode) == -1) {
+    if (cli(argc, argv, input, output, password, mode, options) == -1) {
         return -1;
     }
 
+    EncryptOptions encrypt_options;
+    if (!options.cipher.empty() && !resolve_cipher_suite(options.cipher, encrypt_options.suite)) {
+        std::cerr << "Error: Unknown or unavailable cipher suite: " << options.cipher << std::endl;
+        return -1;
+    }
+
+    FsyncPolicy fsync_policy = FsyncPolicy::BATCHED;
+    if (!options.fsync.empty() && !parse_fsync_policy(options.fsync, fsync_policy)) {
+        std::cerr << "Error: Unknown fsync policy: " << options.fsync << std::endl;
+        return -1;
+    }
+    set_default_fsync_policy(fsync_policy);
+
     try {
+        if (mode == "verify" && is_container_file(input)) {
+            std::cout << "Verifying container " << input << "..." << std::endl;
+            ContainerStats stats;
+            bool ok = verify_container(input, password, stats);
+            secure_clear(password);
+            if (stats.file_size) {
+                std::cout << "Container: " << stats.entries << " entries, " << stats.live_bytes << " of "
+                          << stats.file_size << " bytes live" << std::endl;
+            }
+            if (!ok) {
+                std::cerr << "Verification failed" << std::endl;
+                return -1;
+            }
+            std::cout << "Verification passed" << std::endl;
+            return 0;
+        }
+
+        if (mode == "compact") {
+            std::error_code size_error;
+            uint64_t before = std::filesystem::file_size(input, size_error);
+            ContainerStats stats;
+            bool ok = compact_container(input, password, stats);
+            secure_clear(password);
+            if (!ok) {
+                std::cerr << "Error: Compaction failed" << std::endl;
+                return -1;
+            }
+            std::cout << "Compacted " << input << ": " << stats.entries << " entries, " << before << " -> "
+                      << stats.file_size << " bytes" << std::endl;
+            return 0;
+        }
+
+        if (mode == "verify") {
+            std::cout << "Verifying " << input << "..." << std::endl;
+            VerifyReport report = verify_path(input, password, options.threads);
+            secure_clear(password);
+
+            for (const VerifyEntry& entry : report.entries) {
+                if (entry.ok) {
+                    std::cout << "  OK    " << entry.name << " (" << entry.size << " bytes)" << std::endl;
+                } else {
+                    std::cout << "  FAIL  " << entry.name << ": " << entry.error << std::endl;
+                }
+            }
+            if (report.header.version == LEGACY_FORMAT_VERSION) {
+                std::cout << "Legacy file: end marker checked, archive entries not inspected" << std::endl;
+            } else if (report.chunks) {
+                std::cout << "Payload: " << report.chunks << " chunks, " << report.payload_size << " bytes, "
+                          << find_cipher_suite(report.header.suite)->name << std::endl;
+            }
+
+            if (!report.ok) {
+                std::cerr << "Verification failed: " << report.error << std::endl;
+                return -1;
+            }
+            std::cout << "Verification passed" << std::endl;
+            return 0;
+        }
+
+        if (mode == "rekey") {
+            KeySlotUpdate update;
+            update.change = options.key_change == "add"    ? KeySlotChange::ADD
+                          : options.key_change == "remove" ? KeySlotChange::REMOVE
+                                                           : KeySlotChange::REPLACE;
+            update.new_password = options.new_password;
+            secure_clear(options.new_password);
+            if (update.change != KeySlotChange::REMOVE && !build_kdf_params(options, update.kdf, std::cout)) {
+                return -1;
+            }
+
+            bool rekeyed = is_volume_file(input) ? rekey_volumes(input, options.targets, password, update)
+                                                 : rekey_file(input, password, update);
+            secure_clear(password);
+            secure_clear(update.new_password);
+
+            if (!rekeyed) {
+                std::cerr << "Error: Rekeying failed" << std::endl;
+                return -1;
+            }
+            std::cout << "Key slots updated: " << input << std::endl;
+            return 0;
+        }
+
+        if (input == "-") {
+            // Pipe mode: stdout carries the data, so all messages go to stderr
+            std::ios::sync_with_stdio(false);
+            std::cin.tie(nullptr);
+
+            bool ok = false;
+            if (mode == "enc") {
+                if (!build_kdf_params(options, encrypt_options.kdf, std::cerr)) {
+                    return -1;
+                }
+                encrypt_options.raw_payload = true;
+                ok = encrypt_stream(std::cin, std::cout, password, encrypt_options);
+            } else {
+                ok = decrypt_stream(std::cin, std::cout, password);
+            }
+            secure_clear(password);
+            std::cout.flush();
+
+            if (!ok) {
+                std::cerr << "Error: " << (mode == "enc" ? "Encryption" : "Decryption") << " failed" << std::endl;
+                return -1;
+            }
+            return 0;
+        }
+
+        if (options.mirror) {
+            if (!std::filesystem::is_directory(input)) {
+                std::cerr << "Error: --mirror needs a folder as input: " << input << std::endl;
+                return -1;
+            }
+            if (options.resume || options.volume_size || options.append) {
+                std::cerr << "Error: --mirror cannot be combined with --resume, --volume-size or --append" << std::endl;
+                return -1;
+            }
+
+            BulkStats stats;
+            if (mode == "enc") {
+                if (!build_kdf_params(options, encrypt_options.kdf, std::cout)) {
+                    return -1;
+                }
+                std::cout << "Encrypting tree with " << find_cipher_suite(encrypt_options.suite)->name << "..." << std::endl;
+                stats = encrypt_tree(input, output, password, encrypt_options, options.threads);
+            } else {
+                std::cout << "Decrypting tree..." << std::endl;
+                stats = decrypt_tree(input, output, password, options.threads);
+            }
+            secure_clear(password);
+
+            double mib = stats.bytes / (1024.0 * 1024.0);
+            std::cout << stats.files << " files processed, " << stats.skipped << " up to date, "
+                      << stats.failed << " failed" << std::endl;
+            std::cout << std::fixed << std::setprecision(1) << mib << " MiB in " << stats.seconds << " s";
+            if (stats.seconds > 0) {
+                std::cout << " (" << mib / stats.seconds << " MiB/s)";
+            }
+            std::cout << std::endl;
+            return stats.failed ? -1 : 0;
+        }
+
         if (mode == "enc") {
             // Validate input exists
             if (!std::filesystem::exists(input)) {
@@ -21,11 +226,39 @@ int main(int argc, char* argv[]) {
                 return -1;
             }
 
+            // Appends go to the named container and only seal new or changed files
+            if (options.append) {
+                if (options.resume || options.volume_size) {
+                    std::cerr << "Error: --append cannot be combined with --resume or --volume-size" << std::endl;
+                    return -1;
+                }
+                if (!std::filesystem::exists(output) && !build_kdf_params(options, encrypt_options.kdf, std::cout)) {
+                    return -1;
+                }
+                ContainerStats stats;
+                bool appended = append_to_container(input, output, password, encrypt_options, stats);
+                secure_clear(password);
+
+                if (!appended) {
+                    std::cerr << "Error: Append failed" << std::endl;
+                    return -1;
+                }
+                std::cout << stats.added << " files added, " << stats.unchanged << " unchanged" << std::endl;
+                std::cout << "Container: " << stats.entries << " entries, " << stats.live_bytes << " of "
+                          << stats.file_size << " bytes live" << std::endl;
+                return 0;
+            }
+
             // Create output filename
             output = output + std::filesystem::path(input).extension().string() + ".enc";
             
+            if (options.volume_size && options.resume) {
+                std::cerr << "Error: --resume cannot be combined with --volume-size" << std::endl;
+                return -1;
+            }
+
             // Check if output already exists
-            if (std::filesystem::exists(output)) {
+            if (!options.volume_size && std::filesystem::exists(output)) {
                 std::cout << "Warning: Output file already exists: " << output << std::endl;
                 std::cout << "Continue? (y/N): ";
                 char confirm;
@@ -36,45 +269,46 @@ int main(int argc, char* argv[]) {
                 }
             }
 
-            int file_or_folder = is_file_or_folder(input);
-            if (file_or_folder == -1) {
-                std::cerr << "Error: Invalid input type" << std::endl;
+            if (!build_kdf_params(options, encrypt_options.kdf, std::cout)) {
                 return -1;
             }
 
-            std::string temp_zip = input + ".tmp.zip";
-
-            // Zip the input
-            bool zip_success = false;
-            if (file_or_folder == 1) {
-                zip_success = zip_file(input, temp_zip);
-            } else if (file_or_folder == 0) {
-                zip_success = zip_folder(input, temp_zip);
-            }
+            // Zip, encrypt and save
+            std::cout << "Encrypting with " << find_cipher_suite(encrypt_options.suite)->name << "..." << std::endl;
+            if (options.volume_size) {
+                VolumeOptions volume_options;
+                volume_options.volume_size = options.volume_size;
+                volume_options.targets = options.targets;
+                for (const std::string& target : volume_options.targets) {
+                    std::filesystem::create_directories(target);
+                }
+                std::vector<std::string> volumes = encrypt_path_volumes(input, output, password, encrypt_options,
+                                                                        volume_options);
+                secure_clear(password);
 
-            if (!zip_success) {
-                std::cerr << "Error: Failed to create zip file" << std::endl;
-                return -1;
+                if (volumes.empty()) {
+                    std::cerr << "Error: Encryption failed" << std::endl;
+                    return -1;
+                }
+                for (const std::string& volume : volumes) {
+                    std::cout << "  " << volume << std::endl;
+                }
+                std::cout << "Encryption completed successfully: " << volumes.size() << " volumes" << std::endl;
+                return 0;
             }
 
-            // Encrypt
-            std::cout << "Encrypting..." << std::endl;
-            std::vector<uint8_t> encrypted_data = final_encrypt(password, iterations, length, temp_zip);
+            std::string written = options.resume ? encrypt_path_resumable(input, output, password, encrypt_options)
+                                                 : encrypt_path(input, output, password, encrypt_options);
             
             // Clear password from memory
             secure_clear(password);
             
-            if (encrypted_data.empty()) {
+            if (written.empty()) {
                 std::cerr << "Error: Encryption failed" << std::endl;
-                delete_zip(temp_zip);
                 return -1;
             }
-
-            // Save encrypted file
-            create_new_file(output, encrypted_data);
-            delete_zip(temp_zip);
             
-            std::cout << "Encryption completed successfully: " << output << std::endl;
+            std::cout << "Encryption completed successfully: " << written << std::endl;
 
         } else if (mode == "dec") {
             // Validate encrypted file exists
@@ -84,34 +318,22 @@ int main(int argc, char* argv[]) {
             }
 
             std::cout << "Decrypting..." << std::endl;
-            std::vector<uint8_t> to_be_decrypted = read_a_file(input);
-            if (to_be_decrypted.empty()) {
-                std::cerr << "Error: Failed to read encrypted file" << std::endl;
-                return -1;
+            bool decrypted = false;
+            if (is_container_file(input)) {
+                decrypted = extract_container(input, output, password);
+            } else if (is_volume_file(input)) {
+                decrypted = decrypt_volumes(input, options.targets, output, password);
+            } else {
+                decrypted = options.resume ? decrypt_path_resumable(input, output, password)
+                                           : decrypt_path(input, output, password);
             }
-
-            std::vector<uint8_t> decrypted = decrypt_aes_256(to_be_decrypted, password, iterations);
             
             // Clear password from memory
             secure_clear(password);
             
-            if (decrypted.empty()) {
-                std::cerr << "Error: Decryption failed - wrong password or corrupted file" << std::endl;
+            if (!decrypted) {
                 return -1;
             }
-
-            std::string temp_zip = input + ".tmp.unzipped";
-            create_new_file(temp_zip, decrypted);
-            
-            // Extract
-            if (!unzip_file(temp_zip, output)) {
-                std::cerr << "Error: Failed to extract files" << std::endl;
-                delete_zip(temp_zip);
-                return -1;
-            }
-
-            delete_zip(temp_zip);
-            fix_extracted_directory(output);
             
             std::cout << "Decryption completed successfully: " << output << std::endl;
         }
@@ -122,4 +344,4 @@ int main(int argc, char* argv[]) {
     }
 
     return 0;
-}
\ No newline at end of file
+}